@@ -0,0 +1,238 @@
+// Aggregator benchmark: simulated nodes stream state frames at a fixed
+// rate into the ingest pool while query threads poll the snapshot. Prints
+// one JSON object with the achieved update rate and latency percentiles:
+//   ingest_to_visible  bytes read by a worker -> frame seen by a reader
+//   send_to_visible    frame written by the node -> frame seen by a reader
+//
+// Usage: aggregator_bench [-n nodes] [-r updates/s per node] [-t s]
+//                         [-w workers] [-q query threads] [-S slots] [-p]
+//   -p  carry each node over a pseudo-terminal instead of a pipe
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "ingest.h"
+
+struct BenchOptions {
+    unsigned nodes = 64;
+    double rate = 50;          // Updates per second per node
+    double seconds = 5;
+    unsigned workers = 4;
+    unsigned readers = 2;
+    unsigned slots = 12;
+    bool pty = false;
+};
+
+// Send time of every in-flight frame, by node and sequence number
+static std::atomic<uint64_t> sent_ns[LotSnapshot::kMaxNodes][256];
+static std::atomic<uint32_t> last_sent_occupied[LotSnapshot::kMaxNodes];
+static std::atomic<bool> feeding{true};
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n nodes] [-r updates/s] [-t s] [-w workers] [-q readers] "
+            "[-S slots] [-p]\n", prog);
+    exit(2);
+}
+
+// Writer end for the node and reader end for the pool
+static bool open_line(bool pty, int &write_fd, int &read_fd) {
+    int fds[2];
+
+    if(!pty) {
+        if(pipe(fds) < 0) return false;
+        write_fd = fds[1];
+        read_fd = fds[0];
+        fcntl(read_fd, F_SETFL, O_NONBLOCK);
+        return true;
+    }
+
+    write_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if(write_fd < 0 || grantpt(write_fd) < 0 || unlockpt(write_fd) < 0) return false;
+    read_fd = open_serial(ptsname(write_fd));
+    return read_fd >= 0;
+}
+
+// All simulated nodes, paced from one thread: frame k is due at k / total rate
+static void run_nodes(const BenchOptions &opt, const std::vector<int> &fds, uint64_t *sent_total) {
+    std::mt19937 rng(1);
+    std::vector<NodeFrame> nodes(opt.nodes);
+    uint8_t buf[TELEM_MAX_FRAME];
+    double period_ns = 1e9 / (opt.rate * opt.nodes);
+    uint64_t start = monotonic_ns();
+    uint64_t end = start + (uint64_t)(opt.seconds * 1e9);
+    uint64_t due;
+    uint64_t now;
+    uint64_t k;
+    size_t len;
+
+    for(unsigned i = 0; i < opt.nodes; i++) {
+        nodes[i].node = i;
+        nodes[i].slots = opt.slots;
+    }
+
+    for(k = 0; ; k++) {
+        due = start + (uint64_t)(k * period_ns);
+        if(due >= end) break;
+        while((now = monotonic_ns()) < due) {
+            if(due - now > 200000) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(due - now - 100000));
+            }
+        }
+
+        NodeFrame &frame = nodes[k % opt.nodes];
+        frame.occupied ^= 1u << (rng() % opt.slots);   // One car arrives or leaves
+        frame.seq++;
+        len = encode_frame(frame, buf);
+
+        last_sent_occupied[frame.node].store(frame.occupied, std::memory_order_relaxed);
+        sent_ns[frame.node][frame.seq].store(monotonic_ns(), std::memory_order_release);
+        if(write(fds[frame.node], buf, len) != (ssize_t)len) {
+            perror("node write");
+            break;
+        }
+    }
+    *sent_total = k;
+}
+
+// Poll every node; each new version seen is one latency sample
+static void run_reader(const LotSnapshot &snapshot, unsigned nodes,
+                       std::vector<uint64_t> &ingest_lat, std::vector<uint64_t> &send_lat,
+                       uint64_t *reads) {
+    std::vector<uint32_t> seen(nodes, 0);
+    uint64_t generation = 0;
+    uint64_t count = 0;
+    uint64_t now;
+    NodeView view;
+
+    while(feeding.load(std::memory_order_relaxed)) {
+        if(snapshot.generation() == generation) {
+            std::this_thread::yield();
+            continue;
+        }
+        generation = snapshot.generation();
+
+        for(unsigned node = 0; node < nodes; node++) {
+            if(!snapshot.read(node, view)) continue;
+            count++;
+            if(view.version == seen[node]) continue;
+
+            now = monotonic_ns();
+            seen[node] = view.version;
+            ingest_lat.push_back(now - view.ingest_ns);
+            send_lat.push_back(now - sent_ns[node][view.seq].load(std::memory_order_acquire));
+        }
+    }
+    *reads = count;
+}
+
+static void print_percentiles(const char *name, std::vector<uint64_t> &samples, bool last) {
+    static const double points[] = { 50, 90, 99, 99.9 };
+
+    std::sort(samples.begin(), samples.end());
+    printf("  \"%s_us\": {\"count\": %zu", name, samples.size());
+    if(!samples.empty()) {
+        for(double p : points) {
+            size_t idx = std::min(samples.size() - 1, (size_t)(p / 100 * samples.size()));
+            printf(", \"p%g\": %.1f", p, samples[idx] / 1e3);
+        }
+        printf(", \"max\": %.1f", samples.back() / 1e3);
+    }
+    printf("}%s\n", last ? "" : ",");
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opt;
+    LotSnapshot snapshot;
+    std::vector<int> node_fds;
+    uint64_t sent_total = 0;
+    uint64_t reads = 0;
+    unsigned mismatched = 0;
+    int write_fd;
+    int read_fd;
+    int c;
+
+    while((c = getopt(argc, argv, "n:r:t:w:q:S:p")) != -1) {
+        switch(c) {
+            case 'n': opt.nodes = atoi(optarg); break;
+            case 'r': opt.rate = atof(optarg); break;
+            case 't': opt.seconds = atof(optarg); break;
+            case 'w': opt.workers = atoi(optarg); break;
+            case 'q': opt.readers = atoi(optarg); break;
+            case 'S': opt.slots = atoi(optarg); break;
+            case 'p': opt.pty = true; break;
+            default: usage(argv[0]);
+        }
+    }
+    if(opt.nodes == 0 || opt.nodes > LotSnapshot::kMaxNodes || opt.rate <= 0 ||
+       opt.slots == 0 || opt.slots > TELEM_MAX_SLOTS) {
+        usage(argv[0]);
+    }
+
+    IngestPool pool(snapshot, opt.workers);
+    for(unsigned i = 0; i < opt.nodes; i++) {
+        if(!open_line(opt.pty, write_fd, read_fd)) {
+            perror("line");
+            return 1;
+        }
+        node_fds.push_back(write_fd);
+        pool.add_source(read_fd, "node" + std::to_string(i));
+    }
+    pool.start();
+
+    std::vector<std::vector<uint64_t>> ingest_lat(opt.readers), send_lat(opt.readers);
+    std::vector<uint64_t> reader_reads(opt.readers);
+    std::vector<std::thread> readers;
+    for(unsigned i = 0; i < opt.readers; i++) {
+        readers.emplace_back(run_reader, std::cref(snapshot), opt.nodes, std::ref(ingest_lat[i]),
+                             std::ref(send_lat[i]), &reader_reads[i]);
+    }
+
+    run_nodes(opt, node_fds, &sent_total);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));   // Let the last frames land
+    feeding = false;
+    for(auto &t : readers) {
+        t.join();
+    }
+    pool.stop();
+
+    // The final state of every node must match what it sent last
+    for(unsigned i = 0; i < opt.nodes; i++) {
+        NodeView view;
+        if(!snapshot.read(i, view) || view.occupied != last_sent_occupied[i].load()) {
+            mismatched++;
+        }
+    }
+
+    std::vector<uint64_t> all_ingest, all_send;
+    for(unsigned i = 0; i < opt.readers; i++) {
+        all_ingest.insert(all_ingest.end(), ingest_lat[i].begin(), ingest_lat[i].end());
+        all_send.insert(all_send.end(), send_lat[i].begin(), send_lat[i].end());
+        reads += reader_reads[i];
+    }
+    DecodeStats stats = pool.stats();
+
+    printf("{\n  \"nodes\": %u, \"workers\": %u, \"readers\": %u, \"transport\": \"%s\",\n",
+           opt.nodes, opt.workers, opt.readers, opt.pty ? "pty" : "pipe");
+    printf("  \"updates_sent\": %llu, \"updates_per_s\": %.0f, \"frames_decoded\": %llu,\n",
+           (unsigned long long)sent_total, sent_total / opt.seconds,
+           (unsigned long long)stats.frames);
+    printf("  \"crc_errors\": %llu, \"final_state_mismatches\": %u,\n",
+           (unsigned long long)stats.crc_errors, mismatched);
+    printf("  \"snapshot_reads\": %llu, \"read_retries\": %llu,\n",
+           (unsigned long long)reads, (unsigned long long)snapshot.read_retries());
+    print_percentiles("ingest_to_visible", all_ingest, false);
+    print_percentiles("send_to_visible", all_send, true);
+    printf("}\n");
+
+    for(int fd : node_fds) {
+        close(fd);
+    }
+    return mismatched ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+// SmartPark lot aggregator: ingests telemetry from many controllers and
+// prints free spaces per level and row.
+//
+// Usage: smartpark_aggregator [-c lot.conf] [-w workers] [-i ms] [-s s]
+//                             [-H history] device...
+//   -c  node placement file (see lot_config.h)
+//   -w  ingest worker threads (default 4)
+//   -i  report interval in milliseconds (default 1000)
+//   -s  seconds without a frame before a node counts as stale (default 15,
+//       three missed heartbeats; 0 = never)
+//   -H  append slot transitions to a history file (see history_store.h)
+//   Devices are serial ports, pseudo-terminals, FIFOs or files.
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "ingest.h"
+#include "lot_config.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int) {
+    running = 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-c lot.conf] [-w workers] [-i ms] [-s s] [-H history] device...\n",
+            prog);
+    exit(2);
+}
+
+static void print_summary(const LotSummary &summary, double t) {
+    for(auto &level : summary.levels) {
+        const Occupancy &o = level.second;
+
+        printf("t=%.1fs level %s: free %u/%u (occupied %u, error %u, stale %u) rows:",
+               t, level.first.c_str(), o.free, o.slots, o.occupied, o.error, o.stale);
+        for(auto &row : summary.rows.at(level.first)) {
+            printf(" %s %u/%u", row.first.c_str(), row.second.free, row.second.slots);
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    LotSnapshot snapshot;
+    LotConfig config;
+    HistoryStore history;
+    bool keep_history = false;
+    std::string error;
+    unsigned workers = 4;
+    unsigned interval_ms = 1000;
+    double stale_s = 15;
+    uint64_t start;
+    int opt;
+    int fd;
+
+    while((opt = getopt(argc, argv, "c:w:i:s:H:")) != -1) {
+        switch(opt) {
+            case 'c':
+                if(!config.load(optarg, error)) {
+                    fprintf(stderr, "%s\n", error.c_str());
+                    return 1;
+                }
+                break;
+            case 'w':
+                workers = atoi(optarg);
+                break;
+            case 'i':
+                interval_ms = atoi(optarg);
+                break;
+            case 's':
+                stale_s = atof(optarg);
+                break;
+            case 'H':
+                if(!history.open(optarg, error)) {
+                    fprintf(stderr, "%s\n", error.c_str());
+                    return 1;
+                }
+                keep_history = true;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if(optind >= argc || interval_ms == 0) usage(argv[0]);
+
+    IngestPool pool(snapshot, workers);
+    for(int i = optind; i < argc; i++) {
+        if((fd = open_serial(argv[i])) < 0) {
+            perror(argv[i]);
+            return 1;
+        }
+        pool.add_source(fd, argv[i]);
+    }
+
+    if(keep_history) {
+        pool.set_history(&history);
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    pool.start();
+    start = monotonic_ns();
+
+    // Query side: reads the snapshot without ever blocking the workers
+    while(running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+        uint64_t now = monotonic_ns();
+
+        print_summary(summarize(snapshot, config, now, (uint64_t)(stale_s * 1e9)),
+                      (now - start) / 1e9);
+        if(keep_history) {
+            history.sync();
+        }
+    }
+
+    pool.stop();
+    DecodeStats stats = pool.stats();
+    printf("frames=%llu crc_errors=%llu bad_length=%llu\n",
+           (unsigned long long)stats.frames, (unsigned long long)stats.crc_errors,
+           (unsigned long long)stats.bad_length);
+    return 0;
+}
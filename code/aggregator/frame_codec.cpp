@@ -0,0 +1,121 @@
+#include "frame_codec.h"
+
+static uint32_t get_le(const uint8_t *p, uint8_t bytes) {
+    uint32_t value = 0;
+
+    for(uint8_t i = 0; i < bytes; i++) {
+        value |= (uint32_t)p[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint8_t put_le(uint8_t *p, uint32_t value, uint8_t bytes) {
+    for(uint8_t i = 0; i < bytes; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+    return bytes;
+}
+
+bool FrameDecoder::push(uint8_t c, NodeFrame &frame) {
+    uint16_t crc = TELEM_CRC_INIT;
+
+    if(need_ == 0) {
+        if(c == TELEM_SYNC) {
+            have_ = 0;
+            need_ = 1;
+        }
+        return false;
+    }
+
+    buf_[have_++] = c;
+    if(have_ == 1) {
+        if(c < TELEM_HEADER_LEN - 2 || c > TELEM_MAX_FRAME - 4) {
+            stats_.bad_length++;
+            need_ = 0;
+        } else {
+            need_ = 1 + c + TELEM_CRC_LEN;
+        }
+        return false;
+    }
+    if(have_ < need_) return false;
+    need_ = 0;
+
+    for(uint8_t i = 0; i < have_ - TELEM_CRC_LEN; i++) {
+        crc = telem_crc_update(crc, buf_[i]);
+    }
+    if(crc != get_le(&buf_[have_ - TELEM_CRC_LEN], TELEM_CRC_LEN)) {
+        stats_.crc_errors++;
+        return false;
+    }
+    if(!parse(frame)) {
+        stats_.bad_length++;
+        return false;
+    }
+    stats_.frames++;
+    return true;
+}
+
+// buf_[0] is the length byte
+bool FrameDecoder::parse(NodeFrame &frame) {
+    uint8_t flags = buf_[1] & ~TELEM_TYPE_MASK;
+    uint8_t slots = buf_[4];
+    uint8_t mask_bytes = TELEM_MASK_BYTES(slots);
+    uint8_t expect = TELEM_HEADER_LEN - 2 + 2 * mask_bytes;
+    const uint8_t *p = &buf_[5];
+
+    frame.type = buf_[1] & TELEM_TYPE_MASK;
+    if(frame.type == TELEM_TYPE_HEARTBEAT) expect += 4;
+    if(frame.type == TELEM_TYPE_BOOT) expect += 2;
+    if(frame.type == TELEM_TYPE_PROFILE) expect += TELEM_PROFILE_LEN;
+    if(frame.type == TELEM_TYPE_LATENCY) expect += TELEM_LATENCY_LEN;
+    if(flags & TELEM_FLAG_QUARANTINE) expect += mask_bytes;
+    if(flags & TELEM_FLAG_PULSES) expect += 2 * slots;
+    if(slots > TELEM_MAX_SLOTS || buf_[0] != expect) return false;
+
+    frame.node = buf_[2];
+    frame.seq = buf_[3];
+    frame.slots = slots;
+    frame.occupied = get_le(p, mask_bytes);
+    frame.error = get_le(p + mask_bytes, mask_bytes);
+    frame.quarantined = 0;
+    if(flags & TELEM_FLAG_QUARANTINE) {
+        frame.quarantined = get_le(p + 2 * mask_bytes, mask_bytes);
+        p += mask_bytes;   // The rest of the payload follows the third mask
+    }
+    frame.uptime_s = (frame.type == TELEM_TYPE_HEARTBEAT) ? get_le(p + 2 * mask_bytes, 2) : 0;
+    frame.sleep_permille = (frame.type == TELEM_TYPE_HEARTBEAT) ? get_le(p + 2 * mask_bytes + 2, 2) : 0;
+    frame.boot_ms = (frame.type == TELEM_TYPE_BOOT) ? get_le(p + 2 * mask_bytes, 2) : 0;
+    frame.warm = (frame.type == TELEM_TYPE_BOOT) && (flags & TELEM_FLAG_WARM);
+    return true;
+}
+
+size_t encode_frame(const NodeFrame &frame, uint8_t *out) {
+    uint8_t mask_bytes = TELEM_MASK_BYTES(frame.slots);
+    uint8_t pos = TELEM_HEADER_LEN;
+    uint16_t crc = TELEM_CRC_INIT;
+
+    out[0] = TELEM_SYNC;
+    out[2] = frame.type | (frame.type == TELEM_TYPE_BOOT && frame.warm ? TELEM_FLAG_WARM : 0) |
+             (frame.quarantined ? TELEM_FLAG_QUARANTINE : 0);
+    out[3] = frame.node;
+    out[4] = frame.seq;
+    out[5] = frame.slots;
+    pos += put_le(&out[pos], frame.occupied, mask_bytes);
+    pos += put_le(&out[pos], frame.error, mask_bytes);
+    if(frame.quarantined) {
+        pos += put_le(&out[pos], frame.quarantined, mask_bytes);
+    }
+    if(frame.type == TELEM_TYPE_HEARTBEAT) {
+        pos += put_le(&out[pos], frame.uptime_s, 2);
+        pos += put_le(&out[pos], frame.sleep_permille, 2);
+    } else if(frame.type == TELEM_TYPE_BOOT) {
+        pos += put_le(&out[pos], frame.boot_ms, 2);
+    }
+    out[1] = pos - 2;
+
+    for(uint8_t i = 1; i < pos; i++) {
+        crc = telem_crc_update(crc, out[i]);
+    }
+    pos += put_le(&out[pos], crc, TELEM_CRC_LEN);
+    return pos;
+}
@@ -0,0 +1,62 @@
+#ifndef AGGREGATOR_FRAME_CODEC_H
+#define AGGREGATOR_FRAME_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include "telemetry_proto.h"
+
+// One node report (see telemetry_proto.h for the wire format)
+struct NodeFrame {
+    uint8_t type = TELEM_TYPE_STATE;   // TELEM_TYPE_*
+    uint8_t node = 0;
+    uint8_t seq = 0;
+    uint8_t slots = 0;
+    uint32_t occupied = 0;
+    uint32_t error = 0;
+    uint32_t quarantined = 0;          // Sensors out of the sweep (also in error)
+    uint16_t uptime_s = 0;             // Heartbeats only
+    uint16_t sleep_permille = 0;       // Heartbeats only: share of time the MCU slept
+    uint16_t boot_ms = 0;              // Boot frames only: reset -> first reading
+    bool warm = false;                 // Boot frames only: state resumed across the reset
+};
+
+struct DecodeStats {
+    uint64_t frames = 0;
+    uint64_t crc_errors = 0;
+    uint64_t bad_length = 0;
+};
+
+// Byte-stream decoder for one serial line: hunts for TELEM_SYNC, checks
+// the length and CRC and hands each good frame to a callback. A bad frame
+// is dropped and the hunt starts again. Pulse widths, profiler and
+// latency payloads are skipped.
+class FrameDecoder {
+public:
+    template <typename OnFrame>
+    void feed(const uint8_t *data, size_t len, OnFrame &&on_frame) {
+        NodeFrame frame;
+
+        for(size_t i = 0; i < len; i++) {
+            if(push(data[i], frame)) {
+                on_frame(frame);
+            }
+        }
+    }
+
+    const DecodeStats &stats() const { return stats_; }
+
+private:
+    bool push(uint8_t c, NodeFrame &frame);
+    bool parse(NodeFrame &frame);
+
+    uint8_t buf_[TELEM_MAX_FRAME];     // Length byte onwards
+    uint8_t have_ = 0;
+    uint8_t need_ = 0;                 // 0 = hunting for SYNC
+    DecodeStats stats_;
+};
+
+// Build a frame without pulse widths; out must hold TELEM_MAX_FRAME bytes.
+// Returns the frame length.
+size_t encode_frame(const NodeFrame &frame, uint8_t *out);
+
+#endif // AGGREGATOR_FRAME_CODEC_H
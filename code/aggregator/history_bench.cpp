@@ -0,0 +1,148 @@
+// History store benchmark: fills a fresh history file with synthetic
+// transitions for a whole lot over many days, then times range scans and
+// per-slot dwell queries on it. Prints one JSON object.
+//
+// Usage: history_bench [-f file] [-b bays] [-d days] [-e events/bay/day] [-q queries]
+//   Bays are spread over nodes of 12 slots and the nodes over 4 levels
+//   (node % 4); scans ask for one level over one random hour, dwell
+//   queries for one random slot over one random day.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "history_store.h"
+
+#define SLOTS_PER_NODE  12
+#define LEVELS          4
+
+static const uint64_t kDayMs = 86400000ULL;
+static const uint64_t kHourMs = 3600000ULL;
+static const uint64_t kStartMs = 1767225600000ULL;   // 2026-01-01 00:00 UTC
+
+static double elapsed_us(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - since).count();
+}
+
+static void print_percentiles(const char *name, std::vector<double> &samples, bool last) {
+    std::sort(samples.begin(), samples.end());
+    printf("  \"%s_us\": {\"count\": %zu, \"p50\": %.1f, \"p99\": %.1f, \"max\": %.1f}%s\n",
+           name, samples.size(), samples[samples.size() / 2],
+           samples[std::min(samples.size() - 1, samples.size() * 99 / 100)], samples.back(),
+           last ? "" : ",");
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-f file] [-b bays] [-d days] [-e events/bay/day] [-q queries]\n",
+            prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    std::string path = "/tmp/smartpark_history_bench";
+    unsigned bays = 500;
+    unsigned days = 90;
+    unsigned per_day = 40;
+    unsigned queries = 1000;
+    std::mt19937_64 rng(1);
+    HistoryStore store;
+    std::string error;
+    std::vector<uint8_t> occupied;
+    std::vector<double> scan_us;
+    std::vector<double> dwell_us;
+    uint64_t total;
+    uint64_t scanned = 0;
+    uint64_t time_ms;
+    double append_us;
+    int opt;
+
+    while((opt = getopt(argc, argv, "f:b:d:e:q:")) != -1) {
+        switch(opt) {
+            case 'f': path = optarg; break;
+            case 'b': bays = atoi(optarg); break;
+            case 'd': days = atoi(optarg); break;
+            case 'e': per_day = atoi(optarg); break;
+            case 'q': queries = atoi(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if(bays == 0 || bays > LotSnapshot::kMaxNodes * SLOTS_PER_NODE || days == 0 ||
+       per_day == 0 || queries == 0) {
+        usage(argv[0]);
+    }
+
+    unlink(path.c_str());
+    unlink((path + ".idx").c_str());
+    if(!store.open(path, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    // Append: random bays flip state, spread evenly over the whole period
+    total = (uint64_t)bays * days * per_day;
+    occupied.assign(bays, 0);
+    auto start = std::chrono::steady_clock::now();
+    for(uint64_t i = 0; i < total; i++) {
+        unsigned bay = rng() % bays;
+
+        occupied[bay] ^= 1;
+        time_ms = kStartMs + i * days * kDayMs / total;
+        if(!store.append(time_ms, bay / SLOTS_PER_NODE, bay % SLOTS_PER_NODE,
+                         occupied[bay] ? SLOT_OCCUPIED : SLOT_FREE)) {
+            fprintf(stderr, "append failed at %llu\n", (unsigned long long)i);
+            return 1;
+        }
+    }
+    store.sync();
+    append_us = elapsed_us(start);
+
+    // Reopen read-only, as history_query does
+    store.close();
+    start = std::chrono::steady_clock::now();
+    if(!store.open(path, error, 0)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    double open_us = elapsed_us(start);
+
+    std::bitset<LotSnapshot::kMaxNodes> level;
+    for(unsigned node = 1; node < LotSnapshot::kMaxNodes; node += LEVELS) {
+        level.set(node);
+    }
+
+    for(unsigned q = 0; q < queries; q++) {
+        uint64_t from = kStartMs + rng() % (days * kDayMs - kHourMs);
+        uint64_t count = 0;
+
+        start = std::chrono::steady_clock::now();
+        store.scan(from, from + kHourMs, &level, [&](const HistoryEvent &) { count++; });
+        scan_us.push_back(elapsed_us(start));
+        scanned += count;
+    }
+
+    for(unsigned q = 0; q < queries; q++) {
+        unsigned bay = rng() % bays;
+        uint64_t from = kStartMs + rng() % ((days - (days > 1)) * kDayMs + 1);
+
+        start = std::chrono::steady_clock::now();
+        DwellStats d = store.dwell(bay / SLOTS_PER_NODE, bay % SLOTS_PER_NODE, from, from + kDayMs);
+        dwell_us.push_back(elapsed_us(start));
+        if(d.occupied_ms > kDayMs) {
+            fprintf(stderr, "dwell out of range\n");
+            return 1;
+        }
+    }
+
+    printf("{\n  \"bays\": %u, \"days\": %u, \"events\": %llu, \"file_bytes\": %llu,\n",
+           bays, days, (unsigned long long)store.size(), (unsigned long long)store.file_bytes());
+    printf("  \"append_per_s\": %.0f, \"open_us\": %.1f,\n", total / (append_us / 1e6), open_us);
+    printf("  \"scan_events_per_query\": %.1f,\n", (double)scanned / queries);
+    print_percentiles("level_hour_scan", scan_us, false);
+    print_percentiles("slot_day_dwell", dwell_us, true);
+    printf("}\n");
+    return 0;
+}
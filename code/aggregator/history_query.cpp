@@ -0,0 +1,157 @@
+// Query an occupancy history file written by smartpark_aggregator -H.
+//
+// Usage: history_query [-c lot.conf] [-l level] [-r row] [-n node] [-s slot]
+//                      [-D] -f from -t to history
+//   -f/-t  time range, "YYYY-MM-DD HH:MM[:SS]" (local time) or Unix seconds
+//   -l/-r  only nodes on this level / row (needs -c)
+//   -n/-s  only this node / slot
+//   -D     print time occupied per slot instead of the events
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <unistd.h>
+#include "history_store.h"
+#include "lot_config.h"
+
+static const char *const state_names[] = { "free", "occupied", "error" };
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-c lot.conf] [-l level] [-r row] [-n node] [-s slot] [-D] "
+            "-f from -t to history\n", prog);
+    exit(2);
+}
+
+static bool parse_time(const char *text, uint64_t &ms) {
+    struct tm tm;
+    const char *end;
+    char *num_end;
+    long long secs = strtoll(text, &num_end, 10);
+
+    if(*text && *num_end == '\0') {
+        ms = (uint64_t)secs * 1000;
+        return true;
+    }
+
+    memset(&tm, 0, sizeof(tm));
+    end = strptime(text, "%Y-%m-%d %H:%M", &tm);
+    if(end && *end == ':') end = strptime(end, ":%S", &tm);
+    if(!end || *end) return false;
+    tm.tm_isdst = -1;
+    ms = (uint64_t)mktime(&tm) * 1000;
+    return true;
+}
+
+static void format_time(uint64_t ms, char *buf, size_t len) {
+    time_t secs = ms / 1000;
+    struct tm tm;
+    size_t n;
+
+    localtime_r(&secs, &tm);
+    n = strftime(buf, len, "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(buf + n, len - n, ".%03u", (unsigned)(ms % 1000));
+}
+
+static void format_span(uint64_t ms, char *buf, size_t len) {
+    uint64_t s = ms / 1000;
+
+    snprintf(buf, len, "%lluh%02llum%02llus", (unsigned long long)(s / 3600),
+             (unsigned long long)(s / 60 % 60), (unsigned long long)(s % 60));
+}
+
+int main(int argc, char **argv) {
+    HistoryStore history;
+    LotConfig config;
+    std::bitset<LotSnapshot::kMaxNodes> nodes;
+    std::string error;
+    std::string level;
+    std::string row;
+    uint64_t from_ms = 0;
+    uint64_t to_ms = 0;
+    bool have_from = false;
+    bool have_to = false;
+    bool have_config = false;
+    bool dwell = false;
+    int only_node = -1;
+    int only_slot = -1;
+    uint64_t matched = 0;
+    char when[40];
+    int opt;
+
+    while((opt = getopt(argc, argv, "c:l:r:n:s:Df:t:")) != -1) {
+        switch(opt) {
+            case 'c':
+                if(!config.load(optarg, error)) {
+                    fprintf(stderr, "%s\n", error.c_str());
+                    return 1;
+                }
+                have_config = true;
+                break;
+            case 'l': level = optarg; break;
+            case 'r': row = optarg; break;
+            case 'n': only_node = atoi(optarg); break;
+            case 's': only_slot = atoi(optarg); break;
+            case 'D': dwell = true; break;
+            case 'f': have_from = parse_time(optarg, from_ms); break;
+            case 't': have_to = parse_time(optarg, to_ms); break;
+            default: usage(argv[0]);
+        }
+    }
+    if(optind + 1 != argc || !have_from || !have_to) usage(argv[0]);
+    if(!level.empty() && !have_config) {
+        fprintf(stderr, "-l needs a lot config (-c)\n");
+        return 2;
+    }
+
+    // History files may be large: map them at their current size only
+    if(!history.open(argv[optind], error, 0)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    if(!level.empty()) {
+        nodes = config.nodes_at(level, row);
+    } else {
+        nodes.set();
+    }
+    if(only_node >= 0) {
+        nodes &= std::bitset<LotSnapshot::kMaxNodes>().set(only_node);
+    }
+
+    if(dwell) {
+        char occupied[24];
+        char longest[24];
+        char errors[24];
+
+        for(unsigned node = 0; node < LotSnapshot::kMaxNodes; node++) {
+            if(!nodes.test(node)) continue;
+            for(unsigned slot = 0; slot < HistoryStore::kMaxSlots; slot++) {
+                if(only_slot >= 0 && (int)slot != only_slot) continue;
+                if(!history.has_events(node, slot)) continue;
+
+                DwellStats d = history.dwell(node, slot, from_ms, to_ms);
+                format_span(d.occupied_ms, occupied, sizeof(occupied));
+                format_span(d.longest_ms, longest, sizeof(longest));
+                format_span(d.error_ms, errors, sizeof(errors));
+                printf("node=%u slot=%u occupied=%s (%.1f%%) arrivals=%u longest=%s error=%s\n",
+                       node, slot, occupied, 100.0 * d.occupied_ms / (to_ms - from_ms),
+                       d.arrivals, longest, errors);
+                matched++;
+            }
+        }
+        printf("slots=%llu\n", (unsigned long long)matched);
+        return 0;
+    }
+
+    history.scan(from_ms, to_ms, &nodes, [&](const HistoryEvent &ev) {
+        if(only_slot >= 0 && ev.slot != only_slot) return;
+        format_time(ev.time_ms, when, sizeof(when));
+        printf("%s node=%u slot=%u %s\n", when, ev.node, ev.slot,
+               ev.state <= SLOT_ERROR ? state_names[ev.state] : "?");
+        matched++;
+    });
+    printf("events=%llu\n", (unsigned long long)matched);
+    return 0;
+}
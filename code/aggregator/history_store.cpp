@@ -0,0 +1,304 @@
+#include "history_store.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#define HISTORY_MAGIC     "SPHIST1"
+#define HISTORY_VERSION   1
+
+// Records added to the files each time they fill up (16 MiB of records)
+static const uint64_t kGrowRecords = 1ULL << 20;
+
+struct HistoryStore::HistoryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t index_stride;
+    uint32_t max_slots;
+    uint64_t count;                                        // Committed records
+    uint32_t heads[LotSnapshot::kMaxNodes][kMaxSlots];     // Newest event + 1 per slot
+};
+
+static const size_t kDataOffset = 32768;   // Header, padded to whole pages
+
+uint64_t wall_clock_ms() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static size_t index_entries(uint64_t records) {
+    return (records + HistoryStore::kIndexStride - 1) / HistoryStore::kIndexStride;
+}
+
+HistoryStore::~HistoryStore() {
+    close();
+}
+
+bool HistoryStore::open(const std::string &path, std::string &error, uint64_t capacity) {
+    int prot = PROT_READ | PROT_WRITE;
+    struct stat st;
+
+    static_assert(sizeof(HistoryHeader) <= kDataOffset, "header too large");
+    close();
+    read_only_ = (capacity == 0);
+
+    fd_ = ::open(path.c_str(), read_only_ ? O_RDONLY : (O_RDWR | O_CREAT), 0644);
+    if(fd_ < 0 || fstat(fd_, &st) < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    if(read_only_) {
+        if((size_t)st.st_size < kDataOffset) {
+            error = path + ": not a history file";
+            return false;
+        }
+        capacity = kDefaultCapacity;   // Mapping beyond the end is harmless
+        prot = PROT_READ;
+    } else if(st.st_size == 0 && ftruncate(fd_, kDataOffset) < 0) {
+        error = path + ": " + strerror(errno);
+        return false;
+    }
+    capacity_ = capacity;
+
+    // Map the full capacity once; only the part backed by the file is used
+    map_bytes_ = kDataOffset + capacity_ * sizeof(HistoryEvent);
+    map_ = (uint8_t *)mmap(nullptr, map_bytes_, prot, MAP_SHARED, fd_, 0);
+    if(map_ == MAP_FAILED) {
+        map_ = nullptr;
+        error = path + ": mmap: " + strerror(errno);
+        return false;
+    }
+    header_ = (HistoryHeader *)map_;
+    records_ = (HistoryEvent *)(map_ + kDataOffset);
+
+    if(st.st_size == 0) {
+        memcpy(header_->magic, HISTORY_MAGIC, sizeof(header_->magic));
+        header_->version = HISTORY_VERSION;
+        header_->record_size = sizeof(HistoryEvent);
+        header_->index_stride = kIndexStride;
+        header_->max_slots = kMaxSlots;
+        st.st_size = kDataOffset;
+    } else if(memcmp(header_->magic, HISTORY_MAGIC, sizeof(header_->magic)) ||
+              header_->version != HISTORY_VERSION ||
+              header_->record_size != sizeof(HistoryEvent) ||
+              header_->index_stride != kIndexStride || header_->max_slots != kMaxSlots) {
+        error = path + ": not a history file of this version";
+        return false;
+    }
+
+    file_records_ = (st.st_size - kDataOffset) / sizeof(HistoryEvent);
+    read_only_count_ = std::min(file_records_, (uint64_t)header_->count);
+    if(!read_only_ && (header_->count > file_records_ || header_->count > capacity_)) {
+        error = path + ": truncated or larger than the capacity";
+        return false;
+    }
+    return open_index(path + ".idx", error);
+}
+
+// The index file is mapped like the records. Read-only stores load it
+// into private memory instead, so a missing tail can still be filled in.
+bool HistoryStore::open_index(const std::string &path, std::string &error) {
+    uint64_t count = read_only_ ? read_only_count_ : header_->count;
+    size_t have = 0;
+    struct stat st;
+    ssize_t got;
+
+    index_map_bytes_ = (index_entries(capacity_) + 1) * sizeof(uint64_t);
+
+    if(read_only_) {
+        index_ = (uint64_t *)mmap(nullptr, index_map_bytes_, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        index_fd_ = ::open(path.c_str(), O_RDONLY);
+        if(index_ != MAP_FAILED && index_fd_ >= 0) {
+            got = pread(index_fd_, index_, index_entries(count) * sizeof(uint64_t), 0);
+            have = (got > 0) ? got / sizeof(uint64_t) : 0;
+        }
+    } else {
+        index_fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if(index_fd_ < 0 || fstat(index_fd_, &st) < 0 ||
+           ftruncate(index_fd_, index_entries(file_records_) * sizeof(uint64_t)) < 0) {
+            error = path + ": " + strerror(errno);
+            return false;
+        }
+        have = st.st_size / sizeof(uint64_t);
+        index_ = (uint64_t *)mmap(nullptr, index_map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                  index_fd_, 0);
+    }
+    if(index_ == MAP_FAILED) {
+        index_ = nullptr;
+        error = path + ": mmap: " + strerror(errno);
+        return false;
+    }
+
+    // After a crash the index may lag the records: fill in what is missing
+    for(size_t i = have; i < index_entries(count); i++) {
+        index_[i] = records_[i * kIndexStride].time_ms;
+    }
+    return true;
+}
+
+void HistoryStore::close() {
+    if(map_) {
+        if(!read_only_) sync();
+        munmap(map_, map_bytes_);
+    }
+    if(index_) {
+        munmap(index_, index_map_bytes_);
+    }
+    if(fd_ >= 0) ::close(fd_);
+    if(index_fd_ >= 0) ::close(index_fd_);
+    fd_ = index_fd_ = -1;
+    map_ = nullptr;
+    index_ = nullptr;
+    header_ = nullptr;
+    records_ = nullptr;
+}
+
+// Extend both files so at least `records` records fit
+bool HistoryStore::grow(uint64_t records) {
+    uint64_t target = std::min(capacity_, std::max(records, file_records_ + kGrowRecords));
+
+    if(ftruncate(fd_, kDataOffset + target * sizeof(HistoryEvent)) < 0 ||
+       ftruncate(index_fd_, index_entries(target) * sizeof(uint64_t)) < 0) {
+        return false;
+    }
+    file_records_ = target;
+    return true;
+}
+
+bool HistoryStore::append(uint64_t time_ms, uint8_t node, uint8_t slot, SlotState state) {
+    std::lock_guard<std::mutex> hold(append_lock_);
+    uint64_t count = header_->count;
+    HistoryEvent *ev;
+
+    if(read_only_ || slot >= kMaxSlots || count >= capacity_) return false;
+    if(count >= file_records_ && !grow(count + 1)) return false;
+
+    if(count && time_ms < records_[count - 1].time_ms) {
+        time_ms = records_[count - 1].time_ms;
+    }
+
+    ev = &records_[count];
+    ev->time_ms = time_ms;
+    ev->node = node;
+    ev->slot = slot;
+    ev->state = state;
+    ev->reserved = 0;
+    ev->prev = header_->heads[node][slot];
+
+    if(count % kIndexStride == 0) {
+        index_[count / kIndexStride] = time_ms;
+    }
+
+    // Record first, then the slot chain, then the count readers go by
+    __atomic_store_n(&header_->heads[node][slot], (uint32_t)(count + 1), __ATOMIC_RELEASE);
+    __atomic_store_n(&header_->count, count + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void HistoryStore::sync() {
+    if(!map_ || read_only_) return;
+
+    msync(map_, kDataOffset + size() * sizeof(HistoryEvent), MS_ASYNC);
+    msync(index_, index_entries(size()) * sizeof(uint64_t), MS_ASYNC);
+}
+
+uint64_t HistoryStore::size() const {
+    if(read_only_) return read_only_count_;
+    return __atomic_load_n(&header_->count, __ATOMIC_ACQUIRE);
+}
+
+uint64_t HistoryStore::file_bytes() const {
+    return kDataOffset + file_records_ * sizeof(HistoryEvent);
+}
+
+bool HistoryStore::has_events(uint8_t node, uint8_t slot) const {
+    return slot < kMaxSlots && __atomic_load_n(&header_->heads[node][slot], __ATOMIC_ACQUIRE) != 0;
+}
+
+// Index of the first record at or after time_ms: binary search of the
+// sparse index, then of one block of records
+uint64_t HistoryStore::first_at_or_after(uint64_t time_ms, uint64_t count) const {
+    size_t blocks = index_entries(count);
+    size_t block = std::lower_bound(index_, index_ + blocks, time_ms) - index_;
+    uint64_t lo = (block > 0) ? (block - 1) * (uint64_t)kIndexStride : 0;
+    uint64_t hi = std::min(count, (uint64_t)block * kIndexStride);
+
+    if(hi <= lo) return hi;
+    return std::lower_bound(records_ + lo, records_ + hi, time_ms,
+                            [](const HistoryEvent &ev, uint64_t t) { return ev.time_ms < t; }) -
+           records_;
+}
+
+// Link to the slot's newest event before to_ms. Looking back a few blocks
+// from to_ms in the time-ordered log is usually much shorter than walking
+// the chain from the newest event; a slot that has been quiet longer than
+// that falls back to the chain.
+uint32_t HistoryStore::last_before(uint8_t node, uint8_t slot, uint64_t to_ms,
+                                   uint64_t count) const {
+    static const uint64_t kLookBack = 4 * kIndexStride;
+    uint64_t end = first_at_or_after(to_ms, count);
+
+    for(uint64_t i = end; i > 0 && end - i < kLookBack; i--) {
+        if(records_[i - 1].node == node && records_[i - 1].slot == slot) return (uint32_t)i;
+    }
+    return __atomic_load_n(&header_->heads[node][slot], __ATOMIC_ACQUIRE);
+}
+
+// Walk the slot's chain back from its newest event to the state at from_ms,
+// then replay forward over the range
+DwellStats HistoryStore::dwell(uint8_t node, uint8_t slot, uint64_t from_ms,
+                               uint64_t to_ms) const {
+    DwellStats stats;
+    std::vector<const HistoryEvent *> in_range;
+    uint8_t state = SLOT_FREE;
+    uint64_t since = from_ms;
+    uint64_t count = size();
+    uint32_t link;
+
+    if(slot >= kMaxSlots || to_ms <= from_ms) return stats;
+
+    link = last_before(node, slot, to_ms, count);
+    while(link) {
+        const HistoryEvent &ev = records_[link - 1];
+        bool visible = (link <= count);   // Read-only stores see a snapshot
+
+        link = ev.prev;
+        if(!visible || ev.time_ms >= to_ms) continue;
+        if(ev.time_ms <= from_ms) {
+            state = ev.state;
+            break;
+        }
+        in_range.push_back(&ev);
+    }
+
+    auto close_span = [&](uint64_t end) {
+        uint64_t span = end - since;
+
+        if(state == SLOT_OCCUPIED) {
+            stats.occupied_ms += span;
+            stats.longest_ms = std::max(stats.longest_ms, span);
+        } else if(state == SLOT_ERROR) {
+            stats.error_ms += span;
+        }
+    };
+
+    for(auto it = in_range.rbegin(); it != in_range.rend(); ++it) {
+        const HistoryEvent &ev = **it;
+
+        if(ev.state == state) continue;    // Repeated after a restart
+        close_span(ev.time_ms);
+        if(ev.state == SLOT_OCCUPIED) stats.arrivals++;
+        state = ev.state;
+        since = ev.time_ms;
+    }
+    close_span(to_ms);
+    return stats;
+}
@@ -0,0 +1,124 @@
+#ifndef AGGREGATOR_HISTORY_STORE_H
+#define AGGREGATOR_HISTORY_STORE_H
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "lot_snapshot.h"
+
+// Append-only log of slot transitions, memory-mapped so queries touch only
+// the pages they need.
+//
+// <path>      header (HistoryHeader, kDataOffset bytes) then HistoryEvent
+//             records, 16 bytes each, in non-decreasing time order
+// <path>.idx  sparse time index: time of every kIndexStride-th record,
+//             rebuilt from the records if it is missing or short
+//
+// Every record also links to the previous event of the same slot, and the
+// header keeps the newest event per slot, so per-slot queries walk only
+// that slot's events. The whole capacity is mapped once up front and the
+// file is grown underneath, so the mapping never moves and readers need
+// no lock; appends are serialised by a mutex.
+
+enum SlotState : uint8_t {
+    SLOT_FREE = 0,
+    SLOT_OCCUPIED = 1,
+    SLOT_ERROR = 2
+};
+
+struct HistoryEvent {
+    uint64_t time_ms;       // Wall clock, ms since the Unix epoch
+    uint8_t node;
+    uint8_t slot;
+    uint8_t state;          // SlotState
+    uint8_t reserved;
+    uint32_t prev;          // Index + 1 of this slot's previous event, 0 = none
+};
+static_assert(sizeof(HistoryEvent) == 16, "history records are 16 bytes");
+
+// Occupancy of one slot over a time range
+struct DwellStats {
+    uint64_t occupied_ms = 0;
+    uint64_t error_ms = 0;
+    uint64_t longest_ms = 0;    // Longest single stay (clipped to the range)
+    uint32_t arrivals = 0;      // Free/error -> occupied transitions in range
+};
+
+class HistoryStore {
+public:
+    static constexpr unsigned kMaxSlots = 24;
+    static constexpr uint32_t kIndexStride = 1024;
+    static constexpr uint64_t kDefaultCapacity = 256ULL << 20;   // Records (4 GiB)
+
+    HistoryStore() = default;
+    ~HistoryStore();
+    HistoryStore(const HistoryStore &) = delete;
+    HistoryStore &operator=(const HistoryStore &) = delete;
+
+    // Open or create for appending; capacity bounds the mapping, not the
+    // file size. Capacity 0 opens an existing file read-only, as a snapshot
+    // of the records present at that moment (the writer may keep going).
+    bool open(const std::string &path, std::string &error,
+              uint64_t capacity = kDefaultCapacity);
+    void close();
+
+    // Record a transition. Times earlier than the last record are clamped
+    // to it, so the log stays sorted. Returns false when full.
+    bool append(uint64_t time_ms, uint8_t node, uint8_t slot, SlotState state);
+
+    // Flush dirty pages and the index to disk
+    void sync();
+
+    uint64_t size() const;
+    uint64_t file_bytes() const;
+
+    const HistoryEvent &at(uint64_t index) const { return records_[index]; }
+
+    // True once the slot has at least one event
+    bool has_events(uint8_t node, uint8_t slot) const;
+
+    // Call fn(const HistoryEvent &) for every event with from <= time < to,
+    // optionally only for nodes in the set
+    template <typename Fn>
+    void scan(uint64_t from_ms, uint64_t to_ms, const std::bitset<LotSnapshot::kMaxNodes> *nodes,
+              Fn &&fn) const {
+        uint64_t count = size();
+
+        for(uint64_t i = first_at_or_after(from_ms, count); i < count; i++) {
+            const HistoryEvent &ev = records_[i];
+            if(ev.time_ms >= to_ms) break;
+            if(!nodes || nodes->test(ev.node)) fn(ev);
+        }
+    }
+
+    DwellStats dwell(uint8_t node, uint8_t slot, uint64_t from_ms, uint64_t to_ms) const;
+
+private:
+    struct HistoryHeader;
+
+    uint64_t first_at_or_after(uint64_t time_ms, uint64_t count) const;
+    uint32_t last_before(uint8_t node, uint8_t slot, uint64_t to_ms, uint64_t count) const;
+    bool grow(uint64_t records);
+    bool open_index(const std::string &path, std::string &error);
+
+    int fd_ = -1;
+    int index_fd_ = -1;
+    uint8_t *map_ = nullptr;
+    size_t map_bytes_ = 0;
+    uint64_t *index_ = nullptr;      // Time of record i * kIndexStride
+    size_t index_map_bytes_ = 0;
+    HistoryHeader *header_ = nullptr;
+    HistoryEvent *records_ = nullptr;
+    uint64_t capacity_ = 0;
+    uint64_t file_records_ = 0;      // Records the files currently have room for
+    bool read_only_ = false;
+    uint64_t read_only_count_ = 0;   // Records visible to a read-only store
+    std::mutex append_lock_;
+};
+
+// Wall clock in milliseconds since the Unix epoch
+uint64_t wall_clock_ms();
+
+#endif // AGGREGATOR_HISTORY_STORE_H
@@ -0,0 +1,151 @@
+#include "ingest.h"
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+uint64_t monotonic_ns() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int open_serial(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK);
+    struct termios tio;
+
+    if(fd < 0) return -1;
+
+    if(tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B115200);
+        cfsetospeed(&tio, B115200);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+IngestPool::IngestPool(LotSnapshot &snapshot, unsigned workers)
+    : snapshot_(snapshot), worker_count_(workers ? workers : 1) {
+}
+
+IngestPool::~IngestPool() {
+    stop();
+    for(auto &src : sources_) {
+        close(src->fd);
+    }
+}
+
+void IngestPool::add_source(int fd, const std::string &name) {
+    sources_.push_back(std::unique_ptr<Source>(new Source{ fd, name, FrameDecoder() }));
+}
+
+void IngestPool::start() {
+    if(pipe(wake_fds_) < 0) {
+        perror("pipe");
+        return;
+    }
+    if(worker_count_ > sources_.size() && !sources_.empty()) {
+        worker_count_ = sources_.size();
+    }
+    for(unsigned i = 0; i < worker_count_; i++) {
+        threads_.emplace_back(&IngestPool::run_worker, this, i);
+    }
+}
+
+void IngestPool::stop() {
+    if(threads_.empty()) return;
+
+    if(write(wake_fds_[1], "x", 1) != 1) {
+        perror("wake");
+    }
+    for(auto &t : threads_) {
+        t.join();
+    }
+    threads_.clear();
+    close(wake_fds_[0]);
+    close(wake_fds_[1]);
+}
+
+DecodeStats IngestPool::stats() const {
+    DecodeStats total;
+
+    for(auto &src : sources_) {
+        total.frames += src->decoder.stats().frames;
+        total.crc_errors += src->decoder.stats().crc_errors;
+        total.bad_length += src->decoder.stats().bad_length;
+    }
+    return total;
+}
+
+static SlotState slot_state(uint32_t occupied, uint32_t error, uint8_t slot) {
+    if(error & (1u << slot)) return SLOT_ERROR;
+    return (occupied & (1u << slot)) ? SLOT_OCCUPIED : SLOT_FREE;
+}
+
+// Compare a frame with the node's published state, before it is replaced
+void IngestPool::log_transitions(const NodeFrame &frame) {
+    NodeView prev;
+    bool known = snapshot_.read(frame.node, prev);
+    uint64_t now = wall_clock_ms();
+    SlotState state;
+
+    for(uint8_t slot = 0; slot < frame.slots; slot++) {
+        state = slot_state(frame.occupied, frame.error, slot);
+        if(known && slot < prev.slots && state == slot_state(prev.occupied, prev.error, slot)) {
+            continue;
+        }
+        history_->append(now, frame.node, slot, state);
+    }
+}
+
+void IngestPool::run_worker(unsigned index) {
+    std::vector<Source *> mine;
+    std::vector<struct pollfd> fds;
+    uint8_t buf[4096];
+    uint64_t now;
+    ssize_t got;
+
+    for(size_t i = index; i < sources_.size(); i += worker_count_) {
+        mine.push_back(sources_[i].get());
+    }
+    fds.push_back({ wake_fds_[0], POLLIN, 0 });
+    for(Source *src : mine) {
+        fds.push_back({ src->fd, POLLIN, 0 });
+    }
+
+    for(;;) {
+        if(poll(fds.data(), fds.size(), -1) < 0) {
+            if(errno == EINTR) continue;
+            perror("poll");
+            return;
+        }
+        if(fds[0].revents) return;   // stop()
+
+        for(size_t i = 1; i < fds.size(); i++) {
+            if(!fds[i].revents) continue;
+            if(fds[i].revents & (POLLERR | POLLNVAL)) {
+                fds[i].fd = -1;      // Device gone: stop polling it
+                continue;
+            }
+
+            // Drain what is there; one timestamp per read stands for every
+            // frame completed by it
+            while((got = read(fds[i].fd, buf, sizeof(buf))) > 0) {
+                now = monotonic_ns();
+                mine[i - 1]->decoder.feed(buf, (size_t)got, [&](const NodeFrame &frame) {
+                    if(history_) log_transitions(frame);
+                    snapshot_.publish(frame, now);
+                });
+            }
+            if(got == 0 || (errno != EAGAIN && errno != EINTR)) {
+                fds[i].fd = -1;      // End of file or hang-up
+            }
+        }
+    }
+}
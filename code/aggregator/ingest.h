@@ -0,0 +1,60 @@
+#ifndef AGGREGATOR_INGEST_H
+#define AGGREGATOR_INGEST_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_codec.h"
+#include "history_store.h"
+#include "lot_snapshot.h"
+
+// Monotonic clock in nanoseconds (the time base of NodeView::ingest_ns)
+uint64_t monotonic_ns();
+
+// Open a serial device or pseudo-terminal for reading: non-blocking, and
+// raw 115200 8N1 if it is a tty. Returns -1 with errno set on failure.
+int open_serial(const std::string &path);
+
+// Reads telemetry lines on a fixed set of worker threads. Each source is
+// owned by one worker (round robin), which polls its descriptors, decodes
+// the bytes and publishes every frame to the snapshot as soon as it is
+// complete.
+class IngestPool {
+public:
+    IngestPool(LotSnapshot &snapshot, unsigned workers);
+    ~IngestPool();
+
+    // Takes ownership of fd; call before start()
+    void add_source(int fd, const std::string &name);
+
+    // Log every slot transition (and each node's first report) to history;
+    // call before start()
+    void set_history(HistoryStore *history) { history_ = history; }
+
+    void start();
+    void stop();
+
+    // Decoder totals over all sources (call after stop())
+    DecodeStats stats() const;
+
+private:
+    struct Source {
+        int fd;
+        std::string name;
+        FrameDecoder decoder;
+    };
+
+    void run_worker(unsigned index);
+    void log_transitions(const NodeFrame &frame);
+
+    LotSnapshot &snapshot_;
+    HistoryStore *history_ = nullptr;
+    unsigned worker_count_;
+    std::vector<std::unique_ptr<Source>> sources_;
+    std::vector<std::thread> threads_;
+    int wake_fds_[2] = { -1, -1 };    // Readable once stop() is called
+};
+
+#endif // AGGREGATOR_INGEST_H
@@ -0,0 +1,83 @@
+#include "lot_config.h"
+#include <fstream>
+#include <sstream>
+
+bool LotConfig::load(const std::string &path, std::string &error) {
+    std::ifstream in(path);
+    std::string line;
+    unsigned line_no = 0;
+
+    if(!in) {
+        error = path + ": cannot open";
+        return false;
+    }
+
+    while(std::getline(in, line)) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        unsigned node;
+        Placement place;
+
+        line_no++;
+        if(!(fields >> node)) {
+            if(fields.eof()) continue;   // Blank or comment-only line
+        } else if(node < LotSnapshot::kMaxNodes && (fields >> place.level >> place.row)) {
+            nodes_[(uint8_t)node] = place;
+            continue;
+        }
+        error = path + ":" + std::to_string(line_no) + ": expected '<node> <level> <row>'";
+        return false;
+    }
+    return true;
+}
+
+const LotConfig::Placement &LotConfig::placement(uint8_t node) const {
+    static const Placement unplaced = { "?", "?" };
+    auto it = nodes_.find(node);
+
+    return (it != nodes_.end()) ? it->second : unplaced;
+}
+
+std::bitset<LotSnapshot::kMaxNodes> LotConfig::nodes_at(const std::string &level,
+                                                       const std::string &row) const {
+    std::bitset<LotSnapshot::kMaxNodes> nodes;
+
+    for(auto &entry : nodes_) {
+        if(entry.second.level == level && (row.empty() || entry.second.row == row)) {
+            nodes.set(entry.first);
+        }
+    }
+    return nodes;
+}
+
+static void add_node(Occupancy &total, const NodeView &view, bool stale) {
+    unsigned slots = view.slots;
+    unsigned error = __builtin_popcount(view.error);
+    unsigned occupied = __builtin_popcount(view.occupied & ~view.error);
+
+    total.nodes++;
+    total.slots += slots;
+    if(stale) {
+        total.stale += slots;
+        return;
+    }
+    total.error += error;
+    total.occupied += occupied;
+    total.free += slots - error - occupied;
+}
+
+LotSummary summarize(const LotSnapshot &snapshot, const LotConfig &config,
+                     uint64_t now_ns, uint64_t stale_ns) {
+    LotSummary summary;
+    NodeView view;
+    bool stale;
+
+    for(unsigned node = 0; node < LotSnapshot::kMaxNodes; node++) {
+        if(!snapshot.read((uint8_t)node, view)) continue;
+
+        const LotConfig::Placement &place = config.placement((uint8_t)node);
+        stale = stale_ns && now_ns > view.ingest_ns + stale_ns;
+        add_node(summary.levels[place.level], view, stale);
+        add_node(summary.rows[place.level][place.row], view, stale);
+    }
+    return summary;
+}
@@ -0,0 +1,55 @@
+#ifndef AGGREGATOR_LOT_CONFIG_H
+#define AGGREGATOR_LOT_CONFIG_H
+
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "lot_snapshot.h"
+
+// Where each controller sits: one node id per row of bays.
+// Config file, one node per line ('#' starts a comment):
+//   <node id> <level> <row>
+// Nodes that report but are not listed are counted under level "?".
+class LotConfig {
+public:
+    struct Placement {
+        std::string level;
+        std::string row;
+    };
+
+    bool load(const std::string &path, std::string &error);
+    const Placement &placement(uint8_t node) const;
+
+    // Nodes placed on a level (and row, if not empty)
+    std::bitset<LotSnapshot::kMaxNodes> nodes_at(const std::string &level,
+                                                 const std::string &row = "") const;
+
+private:
+    std::map<uint8_t, Placement> nodes_;
+};
+
+// Space counts for a level or a row. Error slots and slots of stale nodes
+// are neither free nor occupied.
+struct Occupancy {
+    unsigned slots = 0;
+    unsigned free = 0;
+    unsigned occupied = 0;
+    unsigned error = 0;
+    unsigned stale = 0;
+    unsigned nodes = 0;
+};
+
+struct LotSummary {
+    std::map<std::string, Occupancy> levels;
+    std::map<std::string, std::map<std::string, Occupancy>> rows;   // [level][row]
+};
+
+// Count free spaces per level and row from the current snapshot. A node
+// whose last frame is older than stale_ns (0 = never stale) is counted as
+// stale.
+LotSummary summarize(const LotSnapshot &snapshot, const LotConfig &config,
+                     uint64_t now_ns, uint64_t stale_ns);
+
+#endif // AGGREGATOR_LOT_CONFIG_H
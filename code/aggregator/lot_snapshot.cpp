@@ -0,0 +1,55 @@
+#include "lot_snapshot.h"
+
+void LotSnapshot::publish(const NodeFrame &frame, uint64_t ingest_ns) {
+    Record &rec = nodes_[frame.node];
+    uint32_t seq;
+
+    while(rec.writer.test_and_set(std::memory_order_acquire)) {
+        // Another line is publishing the same node id: rare and short
+    }
+
+    seq = rec.seq.load(std::memory_order_relaxed);
+    rec.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    rec.occupied.store(frame.occupied, std::memory_order_relaxed);
+    rec.error.store(frame.error, std::memory_order_relaxed);
+    rec.meta.store(frame.slots | ((uint32_t)frame.seq << 8), std::memory_order_relaxed);
+    rec.ingest_ns.store(ingest_ns, std::memory_order_relaxed);
+
+    rec.seq.store(seq + 2, std::memory_order_release);
+    rec.writer.clear(std::memory_order_release);
+
+    generation_.fetch_add(1, std::memory_order_release);
+}
+
+bool LotSnapshot::read(uint8_t node, NodeView &view) const {
+    const Record &rec = nodes_[node];
+    uint32_t before;
+    uint32_t after;
+    uint32_t meta;
+
+    for(;;) {
+        before = rec.seq.load(std::memory_order_acquire);
+        if(before == 0) return false;
+        if(before & 1) {
+            retries_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        view.occupied = rec.occupied.load(std::memory_order_relaxed);
+        view.error = rec.error.load(std::memory_order_relaxed);
+        meta = rec.meta.load(std::memory_order_relaxed);
+        view.ingest_ns = rec.ingest_ns.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = rec.seq.load(std::memory_order_relaxed);
+        if(after == before) break;
+        retries_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    view.slots = (uint8_t)meta;
+    view.seq = (uint8_t)(meta >> 8);
+    view.version = before / 2;
+    return true;
+}
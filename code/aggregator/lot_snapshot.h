@@ -0,0 +1,56 @@
+#ifndef AGGREGATOR_LOT_SNAPSHOT_H
+#define AGGREGATOR_LOT_SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include "frame_codec.h"
+
+// Latest reported state of one node, as a reader sees it
+struct NodeView {
+    uint8_t slots = 0;
+    uint8_t seq = 0;              // Sequence number of the frame shown
+    uint32_t occupied = 0;
+    uint32_t error = 0;
+    uint64_t ingest_ns = 0;       // When the frame's bytes were read (CLOCK_MONOTONIC)
+    uint32_t version = 0;         // Bumped on every publish for this node
+};
+
+// Lot-wide slot state, written by the ingest workers and read by query
+// clients. Every node record is a seqlock: the writer makes the record
+// sequence odd, stores the fields and makes it even again; a reader copies
+// the fields and retries if the sequence was odd or moved meanwhile.
+// Readers take no lock and store nothing on the fast path, so any number
+// of them can poll without slowing ingest. Writers for the same node (two
+// lines reporting one node id) are serialised by a per-record flag that
+// readers ignore.
+class LotSnapshot {
+public:
+    static constexpr unsigned kMaxNodes = 256;
+
+    void publish(const NodeFrame &frame, uint64_t ingest_ns);
+
+    // Copy of one node's state; false if the node never reported
+    bool read(uint8_t node, NodeView &view) const;
+
+    // Total publishes so far; a poller can skip a pass when it is unchanged
+    uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+    // Reads that had to retry because a writer was active
+    uint64_t read_retries() const { return retries_.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Record {
+        std::atomic<uint32_t> seq{0};
+        std::atomic_flag writer = ATOMIC_FLAG_INIT;
+        std::atomic<uint32_t> occupied{0};
+        std::atomic<uint32_t> error{0};
+        std::atomic<uint32_t> meta{0};        // slots | frame seq << 8
+        std::atomic<uint64_t> ingest_ns{0};
+    };
+
+    Record nodes_[kMaxNodes];
+    std::atomic<uint64_t> generation_{0};
+    mutable std::atomic<uint64_t> retries_{0};
+};
+
+#endif // AGGREGATOR_LOT_SNAPSHOT_H
@@ -0,0 +1,40 @@
+#include "clock.h"
+#include <avr/interrupt.h>
+
+// Upper 16 bits of the system clock
+static volatile uint16_t overflow_count = 0;
+
+// Configure Timer1 as the free-running system clock
+void clock_init(void) {
+    TCCR1A = 0;
+    TCCR1B = (1 << CS11);   // Prescaler = 8 (0.5µs per tick at 16MHz)
+    TIMSK1 |= (1 << TOIE1); // Count overflows for the upper word
+}
+
+// Combine a TCNT1 value captured with interrupts disabled (e.g. at the top
+// of an ISR) with the overflow count. An overflow that has happened but not
+// been serviced yet belongs to the capture only if TCNT1 already wrapped.
+uint32_t clock_extend(uint16_t tcnt) {
+    uint16_t high = overflow_count;
+
+    if((TIFR1 & (1 << TOV1)) && tcnt < 0x8000) {
+        high++;
+    }
+    return ((uint32_t)high << 16) | tcnt;
+}
+
+// Current 32-bit timestamp, safe to call from any context
+uint32_t clock_now(void) {
+    uint32_t now;
+    uint8_t sreg = SREG;
+
+    cli();
+    now = clock_extend(TCNT1);
+    SREG = sreg;
+    return now;
+}
+
+// Timer1 Overflow Interrupt (every 32.768ms)
+ISR(TIMER1_OVF_vect) {
+    overflow_count++;
+}
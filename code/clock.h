@@ -0,0 +1,20 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <avr/io.h>
+#include <stdint.h>
+
+// System clock: Timer1 free-running at /8 (0.5us per tick), extended to
+// 32 bits by counting overflows. Wraps after ~35 minutes; compare
+// timestamps by subtraction, never by magnitude.
+#define CLOCK_TICKS_PER_US        2
+#define CLOCK_US_TO_TICKS(us)     ((uint32_t)(us) * CLOCK_TICKS_PER_US)
+#define CLOCK_MS_TO_TICKS(ms)     ((uint32_t)(ms) * 1000UL * CLOCK_TICKS_PER_US)
+#define CLOCK_TICKS_TO_US(ticks)  ((ticks) / CLOCK_TICKS_PER_US)
+
+// --- Public Function Prototypes ---
+void clock_init(void);
+uint32_t clock_now(void);
+uint32_t clock_extend(uint16_t tcnt);
+
+#endif // CLOCK_H
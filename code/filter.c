@@ -0,0 +1,48 @@
+#include "filter.h"
+#include <string.h>
+
+static FilterBank_t bank;
+
+#if SLOT_FILTER == FILTER_MEDIAN3
+#define FILTER_PRIME   median3_prime
+#define FILTER_STEP    median3_update
+#elif SLOT_FILTER == FILTER_MEDIAN5
+#define FILTER_PRIME   median5_prime
+#define FILTER_STEP    median5_update
+#elif SLOT_FILTER == FILTER_EMA
+#define FILTER_PRIME   ema_prime
+#define FILTER_STEP    ema_update
+#endif
+
+void filter_init(void) {
+    bank.primed = 0;
+}
+
+// Feed one reading, get the filtered pulse width (0 = no valid echo)
+uint16_t filter_update(uint8_t slot, uint16_t pulse_ticks) {
+#if SLOT_FILTER == FILTER_NONE
+    (void)slot;
+    return pulse_ticks;
+#else
+    if(!(bank.primed & SENSOR_MASK(slot))) {
+        bank.primed |= SENSOR_MASK(slot);
+        FILTER_PRIME(&bank.slot[slot], pulse_ticks);
+        return pulse_ticks;
+    }
+    return FILTER_STEP(&bank.slot[slot], pulse_ticks);
+#endif
+}
+
+// Forget the history of these slots: their next reading fills the window
+void filter_reset(SensorMask_t slots) {
+    bank.primed &= ~slots;
+}
+
+// Copy the bank out / back in (warm restart)
+void filter_save(FilterBank_t *out) {
+    memcpy(out, &bank, sizeof(bank));
+}
+
+void filter_restore(const FilterBank_t *saved) {
+    memcpy(&bank, saved, sizeof(bank));
+}
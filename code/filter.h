@@ -0,0 +1,172 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+#include "slots.h"
+
+// Per-slot Echo Filters
+// Sits between the raw pulse widths and the slot FSM so a single bad echo
+// (dropout, crosstalk spike) does not flip a slot. Works on Timer1 pulse
+// widths; 0 means no valid echo and is filtered like any other value, so
+// one missing echo is ignored but a run of them still reports an error.
+
+#define FILTER_NONE      0   // Raw readings
+#define FILTER_MEDIAN3   1   // Running median of the last 3 readings
+#define FILTER_MEDIAN5   2   // Running median of the last 5 readings
+#define FILTER_EMA       3   // Fixed-point exponential moving average
+
+// Median-of-5 costs two cycles of lag (300 ms) but removes nearly all
+// single-reading glitches; see host/filter_replay for a comparison
+#ifndef SLOT_FILTER
+#define SLOT_FILTER FILTER_MEDIAN5
+#endif
+
+// Extra readings a step change needs to get through the filter. The EMA
+// has no fixed bound: its lag grows with how far the step overshoots the
+// threshold (with FILTER_EMA_SHIFT 2, about 10 readings from an empty bay
+// down to a car), so an EMA build must define this for the steps it has
+// to pass (main.c refuses to build otherwise).
+#ifndef FILTER_LAG_READINGS
+#if SLOT_FILTER == FILTER_NONE
+#define FILTER_LAG_READINGS 0
+#elif SLOT_FILTER == FILTER_MEDIAN3
+#define FILTER_LAG_READINGS 1
+#elif SLOT_FILTER == FILTER_MEDIAN5
+#define FILTER_LAG_READINGS 2
+#endif
+#endif
+
+// EMA weight of a new reading = 1 / 2^FILTER_EMA_SHIFT
+#ifndef FILTER_EMA_SHIFT
+#define FILTER_EMA_SHIFT 2
+#endif
+
+// Consecutive missing echoes before the EMA reports an error
+#ifndef FILTER_EMA_MISS_LIMIT
+#define FILTER_EMA_MISS_LIMIT 3
+#endif
+
+// --- Filter primitives (constant time per reading, no heap) ---
+
+typedef struct {
+    uint16_t ring[3];
+    uint8_t head;
+} Median3_t;
+
+// Ring of the window in arrival order plus the same values kept sorted:
+// each reading replaces the oldest value in the sorted copy by sliding it
+// to its place, at most 4 moves
+typedef struct {
+    uint16_t ring[5];
+    uint16_t sorted[5];
+    uint8_t head;
+} Median5_t;
+
+typedef struct {
+    uint32_t acc;       // Average << FILTER_EMA_SHIFT, 0 = not started
+    uint8_t misses;
+} Ema_t;
+
+static inline void median3_prime(Median3_t *m, uint16_t x) {
+    m->ring[0] = m->ring[1] = m->ring[2] = x;
+    m->head = 0;
+}
+
+static inline uint16_t median3_update(Median3_t *m, uint16_t x) {
+    uint16_t a;
+    uint16_t b;
+    uint16_t c;
+
+    m->ring[m->head] = x;
+    m->head = (m->head == 2) ? 0 : m->head + 1;
+
+    a = m->ring[0];
+    b = m->ring[1];
+    c = m->ring[2];
+    if(a > b) {
+        b = a;
+        a = m->ring[1];
+    }
+    if(b > c) b = c;             // b = min(max(a, b), c)
+    return (a > b) ? a : b;
+}
+
+static inline void median5_prime(Median5_t *m, uint16_t x) {
+    uint8_t i;
+
+    for(i = 0; i < 5; i++) {
+        m->ring[i] = x;
+        m->sorted[i] = x;
+    }
+    m->head = 0;
+}
+
+static inline uint16_t median5_update(Median5_t *m, uint16_t x) {
+    uint16_t oldest = m->ring[m->head];
+    uint8_t i = 0;
+
+    m->ring[m->head] = x;
+    m->head = (m->head == 4) ? 0 : m->head + 1;
+
+    while(m->sorted[i] != oldest) i++;
+    while(i > 0 && m->sorted[i - 1] > x) {
+        m->sorted[i] = m->sorted[i - 1];
+        i--;
+    }
+    while(i < 4 && m->sorted[i + 1] < x) {
+        m->sorted[i] = m->sorted[i + 1];
+        i++;
+    }
+    m->sorted[i] = x;
+    return m->sorted[2];
+}
+
+static inline void ema_prime(Ema_t *e, uint16_t x) {
+    e->acc = (uint32_t)x << FILTER_EMA_SHIFT;
+    e->misses = 0;
+}
+
+// Missing echoes hold the average until FILTER_EMA_MISS_LIMIT in a row;
+// the next valid reading then restarts it
+static inline uint16_t ema_update(Ema_t *e, uint16_t x) {
+    if(x == 0) {
+        if(e->misses < FILTER_EMA_MISS_LIMIT) e->misses++;
+        if(e->misses >= FILTER_EMA_MISS_LIMIT) e->acc = 0;
+        return (uint16_t)(e->acc >> FILTER_EMA_SHIFT);
+    }
+    e->misses = 0;
+    if(e->acc == 0) {
+        ema_prime(e, x);
+    } else {
+        e->acc = e->acc - (e->acc >> FILTER_EMA_SHIFT) + x;
+    }
+    return (uint16_t)(e->acc >> FILTER_EMA_SHIFT);
+}
+
+// --- Per-slot filter bank (SLOT_FILTER) ---
+#if SLOT_FILTER == FILTER_MEDIAN3
+typedef Median3_t SlotFilter_t;
+#elif SLOT_FILTER == FILTER_MEDIAN5
+typedef Median5_t SlotFilter_t;
+#elif SLOT_FILTER == FILTER_EMA
+typedef Ema_t SlotFilter_t;
+#elif SLOT_FILTER != FILTER_NONE
+#error "Unknown SLOT_FILTER"
+#endif
+
+// The whole bank, as kept in the warm-restart snapshot (restart.h).
+// The first reading of a slot that is not primed fills its window.
+typedef struct {
+    SensorMask_t primed;
+#if SLOT_FILTER != FILTER_NONE
+    SlotFilter_t slot[NUM_SENSORS];
+#endif
+} FilterBank_t;
+
+void filter_init(void);
+uint16_t filter_update(uint8_t slot, uint16_t pulse_ticks);
+void filter_reset(SensorMask_t slots);
+void filter_save(FilterBank_t *out);
+void filter_restore(const FilterBank_t *saved);
+
+#endif // FILTER_H
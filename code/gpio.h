@@ -9,10 +9,73 @@ typedef enum { GPIO_PORT_B, GPIO_PORT_C, GPIO_PORT_D } GpioPort_t;
 typedef enum { GPIO_PIN_INPUT, GPIO_PIN_OUTPUT } GpioDirection_t;
 typedef enum { GPIO_PIN_LOW, GPIO_PIN_HIGH } GpioValue_t;
 
+#define GPIO_INLINE static inline __attribute__((always_inline))
+
+// --- Inline API ---
+// With a constant port and pin these collapse to single sbi/cbi/sbis
+// instructions; the mask forms switch several pins of one port in a single
+// store. A runtime port still works, it just costs a branch.
+
+GPIO_INLINE volatile uint8_t *gpio_ddr_reg(GpioPort_t port) {
+    return (port == GPIO_PORT_B) ? &DDRB : (port == GPIO_PORT_C) ? &DDRC : &DDRD;
+}
+
+GPIO_INLINE volatile uint8_t *gpio_port_reg(GpioPort_t port) {
+    return (port == GPIO_PORT_B) ? &PORTB : (port == GPIO_PORT_C) ? &PORTC : &PORTD;
+}
+
+GPIO_INLINE volatile uint8_t *gpio_pin_reg(GpioPort_t port) {
+    return (port == GPIO_PORT_B) ? &PINB : (port == GPIO_PORT_C) ? &PINC : &PIND;
+}
+
+GPIO_INLINE void gpio_dir(GpioPort_t port, uint8_t pin_num, GpioDirection_t direction) {
+    if (direction == GPIO_PIN_OUTPUT) {
+        *gpio_ddr_reg(port) |= (1 << pin_num);
+    } else {
+        *gpio_ddr_reg(port) &= ~(1 << pin_num);
+    }
+}
+
+GPIO_INLINE void gpio_set(GpioPort_t port, uint8_t pin_num, GpioValue_t value) {
+    if (value == GPIO_PIN_HIGH) {
+        *gpio_port_reg(port) |= (1 << pin_num);
+    } else {
+        *gpio_port_reg(port) &= ~(1 << pin_num);
+    }
+}
+
+GPIO_INLINE GpioValue_t gpio_get(GpioPort_t port, uint8_t pin_num) {
+    return (*gpio_pin_reg(port) & (1 << pin_num)) ? GPIO_PIN_HIGH : GPIO_PIN_LOW;
+}
+
+// Drive every pin in the mask to the same level with one read-modify-write
+GPIO_INLINE void gpio_write_mask(GpioPort_t port, uint8_t pin_mask, GpioValue_t value) {
+    if (value == GPIO_PIN_HIGH) {
+        *gpio_port_reg(port) |= pin_mask;
+    } else {
+        *gpio_port_reg(port) &= ~pin_mask;
+    }
+}
+
+// Set the pins in the mask to the matching bits of 'bits' in one store
+GPIO_INLINE void gpio_write_bits(GpioPort_t port, uint8_t pin_mask, uint8_t bits) {
+    volatile uint8_t *reg = gpio_port_reg(port);
+    *reg = (*reg & ~pin_mask) | (bits & pin_mask);
+}
+
+GPIO_INLINE void gpio_dir_mask(GpioPort_t port, uint8_t pin_mask, GpioDirection_t direction) {
+    if (direction == GPIO_PIN_OUTPUT) {
+        *gpio_ddr_reg(port) |= pin_mask;
+    } else {
+        *gpio_ddr_reg(port) &= ~pin_mask;
+    }
+}
+
 // --- Function Prototypes (Public API) ---
+// Out-of-line wrappers over the inline API, kept for existing callers
 void gpio_set_direction(GpioPort_t port, uint8_t pin_num, GpioDirection_t direction);
 void gpio_set_pullup(GpioPort_t port, uint8_t pin_num, uint8_t enable);
 void gpio_write(GpioPort_t port, uint8_t pin_num, GpioValue_t value);
 GpioValue_t gpio_read(GpioPort_t port, uint8_t pin_num);
 
-#endif // GPIO_H
\ No newline at end of file
+#endif // GPIO_H
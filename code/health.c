@@ -0,0 +1,91 @@
+#include "health.h"
+
+#if HEALTH_ENABLED
+#include <string.h>
+
+SensorHealth_t health_sensors[NUM_SENSORS];
+
+static SensorMask_t quarantined = 0;
+
+void health_init(void) {
+    memset(health_sensors, 0, sizeof(health_sensors));
+    quarantined = 0;
+}
+
+// Slots to fire on this sweep: the sampler's choice without the
+// quarantined sensors, plus those whose next probe is due
+SensorMask_t health_due(SensorMask_t due, uint16_t now_ms) {
+    SensorMask_t waiting = quarantined;
+    SensorMask_t probes = 0;
+    SensorHealth_t *h;
+    uint8_t i;
+
+    for(i = 0; waiting; i++, waiting >>= 1) {
+        if(!(waiting & 0x01)) continue;
+
+        h = &health_sensors[i];
+        if((uint16_t)(now_ms - h->probe_at) >= ((uint16_t)HEALTH_PROBE_MS << h->backoff)) {
+            probes |= SENSOR_MASK(i);
+        }
+    }
+    return (due & ~quarantined) | probes;
+}
+
+// Account for one reading (HealthReading_t) of a sensor that was fired;
+// for a quarantined sensor it is the probe. Returns 1 when the probe
+// brought the sensor back.
+uint8_t health_reading(uint8_t slot, uint8_t result, uint16_t now_ms) {
+    SensorHealth_t *h = &health_sensors[slot];
+    SensorMask_t bit = SENSOR_MASK(slot);
+
+    if(quarantined & bit) {
+        if(result == HEALTH_GOOD) {
+            quarantined &= ~bit;
+            h->range_window = 0;
+            h->range_bad = 0;
+            h->silent = 0;
+            h->good = 1;
+            return 1;
+        }
+        h->probe_at = now_ms;
+        if(h->backoff < HEALTH_PROBE_MAX_SHIFT) {
+            h->backoff++;
+        }
+        return 0;
+    }
+
+    // Out-of-range count over the last 16 readings
+    if(h->range_window & 0x8000) {
+        h->range_bad--;
+    }
+    h->range_window <<= 1;
+    if(result == HEALTH_OUT_OF_RANGE) {
+        h->range_window |= 1;
+        h->range_bad++;
+    }
+
+    if(result == HEALTH_SILENT) {
+        if(h->silent < 0xFF) h->silent++;
+    } else {
+        h->silent = 0;
+    }
+
+    if(result != HEALTH_GOOD) {
+        h->good = 0;
+    } else if(h->good < HEALTH_STABLE_READINGS && ++h->good == HEALTH_STABLE_READINGS) {
+        h->backoff = 0;   // Proven itself: next quarantine starts short again
+    }
+
+    if(h->silent >= HEALTH_SILENT_LIMIT || h->range_bad >= HEALTH_RANGE_LIMIT) {
+        quarantined |= bit;
+        h->probe_at = now_ms;
+        if(h->quarantines < 0xFF) h->quarantines++;
+    }
+    return 0;
+}
+
+SensorMask_t health_quarantined(void) {
+    return quarantined;
+}
+
+#endif // HEALTH_ENABLED
@@ -0,0 +1,62 @@
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include <stdint.h>
+#include "slots.h"
+
+// Sensor Health
+// A sensor that stops answering costs the full echo deadline on every
+// sweep it is in and leaves its slot flickering in error. Every reading is
+// classed as good, out of range (an echo, but too short or too long) or
+// silent (no echo edge at all, as from an unplugged or dead sensor). A
+// sensor is quarantined after HEALTH_SILENT_LIMIT silent readings in a
+// row, or HEALTH_RANGE_LIMIT out-of-range readings among its last 16.
+//
+// Quarantined sensors leave the normal sweep and only fire as probes: the
+// first HEALTH_PROBE_MS after quarantine, then at doubling intervals up to
+// HEALTH_PROBE_MS << HEALTH_PROBE_MAX_SHIFT. A good probe reading brings
+// the sensor back. The interval starts again from HEALTH_PROBE_MS only
+// once it has given HEALTH_STABLE_READINGS good readings in a row, so a
+// flaky sensor does not bounce in and out at the short interval.
+
+#ifndef HEALTH_ENABLED
+#define HEALTH_ENABLED         1
+#endif
+
+#define HEALTH_SILENT_LIMIT    5      // Silent readings in a row
+#define HEALTH_RANGE_LIMIT     12     // Out-of-range readings among the last 16
+#define HEALTH_PROBE_MS        1000   // First probe after quarantine
+#define HEALTH_PROBE_MAX_SHIFT 5      // Longest interval: 32 probe periods
+#define HEALTH_STABLE_READINGS 20     // Good readings that reset the back-off
+
+// Probe times are the low 16 bits of scheduler_millis()
+#if (HEALTH_PROBE_MS << HEALTH_PROBE_MAX_SHIFT) > 60000 || HEALTH_RANGE_LIMIT > 16
+#error "Sensor health limits out of range"
+#endif
+
+typedef enum {
+    HEALTH_GOOD,
+    HEALTH_OUT_OF_RANGE,
+    HEALTH_SILENT
+} HealthReading_t;
+
+typedef struct {
+    uint16_t range_window;      // Bit n: the reading n back was out of range
+    uint8_t range_bad;          // Bits set in range_window
+    uint8_t silent;             // Silent readings in a row
+    uint8_t good;               // Good readings in a row (up to HEALTH_STABLE_READINGS)
+    uint8_t backoff;            // Probe interval is HEALTH_PROBE_MS << backoff
+    uint16_t probe_at;          // Time of quarantine or the last failed probe
+    uint8_t quarantines;        // Times quarantined since reset (saturates)
+} SensorHealth_t;
+
+// Readable by the host simulator after a run
+extern SensorHealth_t health_sensors[NUM_SENSORS];
+
+// --- Public Function Prototypes ---
+void health_init(void);
+SensorMask_t health_due(SensorMask_t due, uint16_t now_ms);
+uint8_t health_reading(uint8_t slot, uint8_t result, uint16_t now_ms);
+SensorMask_t health_quarantined(void);
+
+#endif // HEALTH_H
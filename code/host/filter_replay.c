@@ -0,0 +1,233 @@
+// Filter replay: runs a noisy distance trace through every slot filter and
+// counts the state changes each one would send to the LCD and telemetry.
+//
+// Usage: filter_replay [-n cycles] [-s seed] [-j cm] [-p %] [-k %] [-o cm] [-t cm] [file]
+//   file  trace, one "true_cm measured_cm" line per measurement cycle
+//         (measured 0 = no echo); without it a trace is generated:
+//   -n  cycles to generate (default 20000, 150 ms each)
+//   -s  random seed
+//   -j  Gaussian noise, standard deviation in cm (default 1.5)
+//   -p  missing echoes, percent of readings (default 5)
+//   -k  crosstalk spikes to a random 2..200 cm, percent (default 3)
+//   -o  distance of a parked car in cm (default 7); free bays read 120 cm
+//   -t  occupied threshold in cm (default 10, as in main.c)
+//
+// A transition is "true" when it takes the slot to the state the trace
+// says it has since its last change, and "false" otherwise (a flip and
+// flip-back counts twice). Lag is in measurement cycles.
+
+#include "filter.h"
+#include "ultrasonic.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define MAX_CYCLES   1000000
+#define FREE_CM      120
+
+typedef enum {
+    KIND_NONE,
+    KIND_MEDIAN3,
+    KIND_MEDIAN5,
+    KIND_EMA,
+    KIND_COUNT
+} FilterKind_t;
+
+static const char *const kind_names[KIND_COUNT] = { "none", "median3", "median5", "ema" };
+
+typedef enum {
+    CLASS_FREE,
+    CLASS_OCCUPIED,
+    CLASS_ERROR
+} SlotClass_t;
+
+typedef struct {
+    uint32_t transitions;
+    uint32_t false_transitions;
+    uint32_t matched;
+    uint64_t lag_sum;
+    uint32_t lag_max;
+} ReplayStats_t;
+
+static float truth_cm[MAX_CYCLES];
+static uint16_t reading[MAX_CYCLES];
+static uint32_t cycles = 20000;
+static uint16_t threshold_ticks;
+
+static double gaussian(void) {
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return sqrt(-2.0 * log(u)) * cos(2 * M_PI * v);
+}
+
+static uint16_t cm_to_ticks(double cm) {
+    if(cm <= 0) return 0;
+    return (uint16_t)(cm * TICKS_PER_CM);
+}
+
+// Cars arrive and leave at random: stays average 300 cycles (45 s),
+// gaps 150 cycles
+static void generate(double noise, double miss_pct, double spike_pct, double parked_cm) {
+    uint8_t occupied = 0;
+    uint32_t left = 0;
+    double r;
+    uint32_t i;
+
+    for(i = 0; i < cycles; i++) {
+        if(left == 0) {
+            occupied = !occupied;
+            left = 1 + (uint32_t)(-log((rand() + 1.0) / (RAND_MAX + 1.0)) * (occupied ? 300 : 150));
+        }
+        left--;
+        truth_cm[i] = occupied ? parked_cm : FREE_CM;
+
+        r = 100.0 * rand() / RAND_MAX;
+        if(r < miss_pct) {
+            reading[i] = 0;
+        } else if(r < miss_pct + spike_pct) {
+            reading[i] = cm_to_ticks(2 + rand() % 199);
+        } else {
+            reading[i] = cm_to_ticks(truth_cm[i] + noise * gaussian());
+        }
+    }
+}
+
+static int load(const char *path) {
+    FILE *f = fopen(path, "r");
+    float measured;
+
+    if(!f) {
+        perror(path);
+        return 0;
+    }
+    cycles = 0;
+    while(cycles < MAX_CYCLES && fscanf(f, "%f %f", &truth_cm[cycles], &measured) == 2) {
+        reading[cycles++] = cm_to_ticks(measured);
+    }
+    fclose(f);
+    return 1;
+}
+
+// Same rule as update_fsm_all()
+static SlotClass_t classify(uint16_t pulse) {
+    if(pulse == 0) return CLASS_ERROR;
+    return (pulse <= threshold_ticks) ? CLASS_OCCUPIED : CLASS_FREE;
+}
+
+// What the slot really is during cycle i
+static SlotClass_t truth_at(uint32_t i) {
+    return (cm_to_ticks(truth_cm[i]) <= threshold_ticks) ? CLASS_OCCUPIED : CLASS_FREE;
+}
+
+static void replay(FilterKind_t kind, ReplayStats_t *stats) {
+    Median3_t m3 = {{0}};
+    Median5_t m5 = {{0}};
+    Ema_t ema = {0};
+    SlotClass_t shown = CLASS_FREE;
+    SlotClass_t truth;
+    SlotClass_t now;
+    uint8_t pending = 0;        // Truth changed and the filter has not followed yet
+    uint32_t since = 0;
+    uint16_t out = 0;
+    uint32_t i;
+
+    for(i = 0; i < cycles; i++) {
+        truth = truth_at(i);
+        if(i > 0 && truth != truth_at(i - 1)) {
+            pending = 1;
+            since = i;
+        }
+
+        switch(kind) {
+            case KIND_MEDIAN3:
+                if(i == 0) median3_prime(&m3, reading[i]);
+                out = median3_update(&m3, reading[i]);
+                break;
+            case KIND_MEDIAN5:
+                if(i == 0) median5_prime(&m5, reading[i]);
+                out = median5_update(&m5, reading[i]);
+                break;
+            case KIND_EMA:
+                if(i == 0) ema_prime(&ema, reading[i]);
+                out = ema_update(&ema, reading[i]);
+                break;
+            default:
+                out = reading[i];
+        }
+
+        now = classify(out);
+        if(i == 0) {
+            shown = now;
+            continue;
+        }
+        if(now == shown) continue;
+
+        shown = now;
+        stats->transitions++;
+        if(pending && now == truth) {
+            pending = 0;
+            stats->matched++;
+            stats->lag_sum += i - since;
+            if(i - since > stats->lag_max) stats->lag_max = i - since;
+        } else {
+            stats->false_transitions++;
+        }
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-n cycles] [-s seed] [-j cm] [-p %%] [-k %%] [-o cm] [-t cm] [file]\n",
+            prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    ReplayStats_t stats[KIND_COUNT] = {{0}};
+    double noise = 1.5;
+    double miss_pct = 5;
+    double spike_pct = 3;
+    double parked_cm = 7;
+    uint32_t true_changes = 0;
+    int threshold_cm = 10;
+    int opt;
+    int k;
+    uint32_t i;
+
+    while((opt = getopt(argc, argv, "n:s:j:p:k:o:t:")) != -1) {
+        switch(opt) {
+            case 'n': cycles = atoi(optarg); break;
+            case 's': srand(atoi(optarg)); break;
+            case 'j': noise = atof(optarg); break;
+            case 'p': miss_pct = atof(optarg); break;
+            case 'k': spike_pct = atof(optarg); break;
+            case 'o': parked_cm = atof(optarg); break;
+            case 't': threshold_cm = atoi(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if(cycles == 0 || cycles > MAX_CYCLES || optind + 1 < argc) usage(argv[0]);
+    threshold_ticks = CM_MAX_TICKS(threshold_cm);
+
+    if(optind < argc) {
+        if(!load(argv[optind])) return 1;
+    } else {
+        generate(noise, miss_pct, spike_pct, parked_cm);
+    }
+
+    for(i = 1; i < cycles; i++) {
+        if(truth_at(i) != truth_at(i - 1)) true_changes++;
+    }
+
+    printf("cycles=%u true_changes=%u\n", cycles, true_changes);
+    printf("%-8s %11s %6s %7s %8s %7s\n", "filter", "transitions", "false", "missed", "mean_lag", "max_lag");
+    for(k = 0; k < KIND_COUNT; k++) {
+        replay((FilterKind_t)k, &stats[k]);
+        printf("%-8s %11u %6u %7u %8.2f %7u\n", kind_names[k], stats[k].transitions,
+               stats[k].false_transitions, true_changes - stats[k].matched,
+               stats[k].matched ? (double)stats[k].lag_sum / stats[k].matched : 0.0,
+               stats[k].lag_max);
+    }
+    return 0;
+}
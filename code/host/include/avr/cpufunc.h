@@ -0,0 +1,10 @@
+#ifndef SIM_AVR_CPUFUNC_H
+#define SIM_AVR_CPUFUNC_H
+
+// Host stand-in for <avr/cpufunc.h>
+
+#include "sim_hal.h"
+
+#define _NOP()  sim_nop()
+
+#endif // SIM_AVR_CPUFUNC_H
@@ -0,0 +1,12 @@
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+// Host stand-in for <avr/interrupt.h>
+
+#include "sim_hal.h"
+
+#define ISR(vector, ...)  void vector(void); void vector(void)
+#define sei()             sim_set_interrupts(1)
+#define cli()             sim_set_interrupts(0)
+
+#endif // SIM_AVR_INTERRUPT_H
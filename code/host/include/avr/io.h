@@ -0,0 +1,226 @@
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+// Host stand-in for <avr/io.h> (ATmega328P register subset)
+
+#include <stdint.h>
+#include "sim_hal.h"
+
+// --- Plain registers ---
+#define PINB     sim_regs[SIM_PINB]
+#define DDRB     sim_regs[SIM_DDRB]
+#define PORTB    sim_regs[SIM_PORTB]
+#define PINC     sim_regs[SIM_PINC]
+#define DDRC     sim_regs[SIM_DDRC]
+#define PORTC    sim_regs[SIM_PORTC]
+#define PIND     sim_regs[SIM_PIND]
+#define DDRD     sim_regs[SIM_DDRD]
+#define PORTD    sim_regs[SIM_PORTD]
+#define PCICR    sim_regs[SIM_PCICR]
+#define PCMSK0   sim_regs[SIM_PCMSK0]
+#define PCMSK1   sim_regs[SIM_PCMSK1]
+#define PCMSK2   sim_regs[SIM_PCMSK2]
+#define TCCR0A   sim_regs[SIM_TCCR0A]
+#define TCCR0B   sim_regs[SIM_TCCR0B]
+#define TCNT0    sim_regs[SIM_TCNT0]
+#define OCR0A    sim_regs[SIM_OCR0A]
+#define OCR0B    sim_regs[SIM_OCR0B]
+#define TIMSK0   sim_regs[SIM_TIMSK0]
+#define TCCR1A   sim_regs[SIM_TCCR1A]
+#define TCCR1B   sim_regs[SIM_TCCR1B]
+#define TCCR1C   sim_regs[SIM_TCCR1C]
+#define TIMSK1   sim_regs[SIM_TIMSK1]
+#define TCCR2A   sim_regs[SIM_TCCR2A]
+#define TCCR2B   sim_regs[SIM_TCCR2B]
+#define TCNT2    sim_regs[SIM_TCNT2]
+#define OCR2A    sim_regs[SIM_OCR2A]
+#define OCR2B    sim_regs[SIM_OCR2B]
+#define TIMSK2   sim_regs[SIM_TIMSK2]
+#define ASSR     sim_regs[SIM_ASSR]
+#define TWBR     sim_regs[SIM_TWBR]
+#define TWSR     sim_regs[SIM_TWSR]
+#define TWAR     sim_regs[SIM_TWAR]
+#define TWDR     sim_regs[SIM_TWDR]
+#define TWAMR    sim_regs[SIM_TWAMR]
+#define SPCR     sim_regs[SIM_SPCR]
+#define SPSR     sim_regs[SIM_SPSR]
+#define SPDR     sim_regs[SIM_SPDR]
+#define ACSR     sim_regs[SIM_ACSR]
+#define UCSR0B   sim_regs[SIM_UCSR0B]
+#define UCSR0C   sim_regs[SIM_UCSR0C]
+#define UBRR0L   sim_regs[SIM_UBRR0L]
+#define UBRR0H   sim_regs[SIM_UBRR0H]
+#define GPIOR0   sim_regs[SIM_GPIOR0]
+#define GPIOR1   sim_regs[SIM_GPIOR1]
+#define GPIOR2   sim_regs[SIM_GPIOR2]
+#define MCUSR    sim_regs[SIM_MCUSR]
+#define SMCR     sim_regs[SIM_SMCR]
+#define PRR      sim_regs[SIM_PRR]
+#define WDTCSR   sim_regs[SIM_WDTCSR]
+
+// --- Synchronising registers ---
+#define SREG     (*sim_io(SIM_SREG))
+#define TIFR0    (*sim_io(SIM_TIFR0))
+#define TIFR1    (*sim_io(SIM_TIFR1))
+#define TIFR2    (*sim_io(SIM_TIFR2))
+#define PCIFR    (*sim_io(SIM_PCIFR))
+#define TWCR     (*sim_io(SIM_TWCR))
+#define UCSR0A   (*sim_io(SIM_UCSR0A))
+#define UDR0     (*sim_udr0())
+#define TCNT1    (*sim_io16(SIM_TCNT1))
+#define OCR1A    (*sim_io16(SIM_OCR1A))
+#define OCR1B    (*sim_io16(SIM_OCR1B))
+#define ICR1     (*sim_io16(SIM_ICR1))
+#define UBRR0    (*sim_io16(SIM_UBRR0))
+
+// --- Interrupt vectors (ISR(x) defines a function named after x) ---
+#define PCINT0_vect        sim_vect_pcint0
+#define PCINT1_vect        sim_vect_pcint1
+#define PCINT2_vect        sim_vect_pcint2
+#define WDT_vect           sim_vect_wdt
+#define TIMER1_COMPA_vect  sim_vect_timer1_compa
+#define TIMER1_COMPB_vect  sim_vect_timer1_compb
+#define TIMER1_OVF_vect    sim_vect_timer1_ovf
+#define TIMER0_COMPA_vect  sim_vect_timer0_compa
+#define USART_RX_vect      sim_vect_usart_rx
+#define USART_UDRE_vect    sim_vect_usart_udre
+#define USART_TX_vect      sim_vect_usart_tx
+#define TWI_vect           sim_vect_twi
+
+// --- Bit positions ---
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+#define SREG_I   7
+
+#define PCIE0    0
+#define PCIE1    1
+#define PCIE2    2
+#define PCIF0    0
+#define PCIF1    1
+#define PCIF2    2
+#define PCINT0   0
+#define PCINT1   1
+#define PCINT2   2
+#define PCINT3   3
+#define PCINT4   4
+#define PCINT5   5
+#define PCINT6   6
+#define PCINT7   7
+#define PCINT8   0
+#define PCINT9   1
+#define PCINT10  2
+#define PCINT11  3
+#define PCINT12  4
+#define PCINT13  5
+#define PCINT14  6
+#define PCINT16  0
+#define PCINT17  1
+#define PCINT18  2
+#define PCINT19  3
+#define PCINT20  4
+#define PCINT21  5
+#define PCINT22  6
+#define PCINT23  7
+
+#define WGM00    0
+#define WGM01    1
+#define WGM02    3
+#define CS00     0
+#define CS01     1
+#define CS02     2
+#define OCIE0A   1
+#define OCIE0B   2
+#define TOIE0    0
+#define OCF0A    1
+#define OCF0B    2
+#define TOV0     0
+
+#define WGM10    0
+#define WGM11    1
+#define WGM12    3
+#define WGM13    4
+#define CS10     0
+#define CS11     1
+#define CS12     2
+#define TOIE1    0
+#define OCIE1A   1
+#define OCIE1B   2
+#define TOV1     0
+#define OCF1A    1
+#define OCF1B    2
+
+#define TWINT    7
+#define TWEA     6
+#define TWSTA    5
+#define TWSTO    4
+#define TWWC     3
+#define TWEN     2
+#define TWIE     0
+#define TWPS0    0
+#define TWPS1    1
+
+#define SPE      6
+
+#define ACD      7
+
+#define RXC0     7
+#define TXC0     6
+#define UDRE0    5
+#define FE0      4
+#define DOR0     3
+#define UPE0     2
+#define U2X0     1
+#define RXCIE0   7
+#define TXCIE0   6
+#define UDRIE0   5
+#define RXEN0    4
+#define TXEN0    3
+#define UCSZ02   2
+#define UCSZ01   2
+#define UCSZ00   1
+
+#define SE       0
+#define SM0      1
+#define SM1      2
+#define SM2      3
+
+#define PRADC    0
+#define PRUSART0 1
+#define PRSPI    2
+#define PRTIM1   3
+#define PRTIM0   5
+#define PRTIM2   6
+#define PRTWI    7
+
+#define PORF     0
+#define EXTRF    1
+#define BORF     2
+#define WDRF     3
+
+#define WDIE     6
+#define WDCE     4
+#define WDE      3
+
+#endif // SIM_AVR_IO_H
@@ -0,0 +1,21 @@
+#ifndef SIM_AVR_SLEEP_H
+#define SIM_AVR_SLEEP_H
+
+// Host stand-in for <avr/sleep.h>
+
+#include <avr/io.h>
+
+#define SLEEP_MODE_IDLE         0
+#define SLEEP_MODE_ADC          (1 << SM0)
+#define SLEEP_MODE_PWR_DOWN     (1 << SM1)
+#define SLEEP_MODE_PWR_SAVE     ((1 << SM0) | (1 << SM1))
+#define SLEEP_MODE_STANDBY      ((1 << SM1) | (1 << SM2))
+#define SLEEP_MODE_EXT_STANDBY  ((1 << SM0) | (1 << SM1) | (1 << SM2))
+
+#define set_sleep_mode(mode) \
+    (SMCR = (SMCR & ~((1 << SM0) | (1 << SM1) | (1 << SM2))) | (mode))
+#define sleep_enable()   (SMCR |= (1 << SE))
+#define sleep_disable()  (SMCR &= ~(1 << SE))
+#define sleep_cpu()      sim_sleep()
+
+#endif // SIM_AVR_SLEEP_H
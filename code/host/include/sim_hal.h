@@ -0,0 +1,63 @@
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+// Firmware-facing side of the host simulation. The avr/ and util/ headers
+// in host/include map registers and intrinsics onto these symbols, so the
+// firmware sources compile unchanged on the host.
+
+#include <stdint.h>
+
+// Plain registers: stored in the register file and sampled by the
+// simulated devices. Their addresses are link-time constants, so tables
+// such as the ones in gpio.c work as on the target.
+typedef enum {
+    SIM_PINB, SIM_DDRB, SIM_PORTB,
+    SIM_PINC, SIM_DDRC, SIM_PORTC,
+    SIM_PIND, SIM_DDRD, SIM_PORTD,
+    SIM_PCICR, SIM_PCMSK0, SIM_PCMSK1, SIM_PCMSK2,
+    SIM_TCCR0A, SIM_TCCR0B, SIM_TCNT0, SIM_OCR0A, SIM_OCR0B, SIM_TIMSK0,
+    SIM_TCCR1A, SIM_TCCR1B, SIM_TCCR1C, SIM_TIMSK1,
+    SIM_TCCR2A, SIM_TCCR2B, SIM_TCNT2, SIM_OCR2A, SIM_OCR2B, SIM_TIMSK2, SIM_ASSR,
+    SIM_TWBR, SIM_TWSR, SIM_TWAR, SIM_TWDR, SIM_TWAMR,
+    SIM_SPCR, SIM_SPSR, SIM_SPDR,
+    SIM_ACSR,
+    SIM_UCSR0B, SIM_UCSR0C, SIM_UBRR0L, SIM_UBRR0H,
+    SIM_GPIOR0, SIM_GPIOR1, SIM_GPIOR2,
+    SIM_MCUSR, SIM_SMCR, SIM_PRR, SIM_WDTCSR,
+    // Registers below are only reached through sim_io() so that every
+    // access synchronises the simulation
+    SIM_SREG, SIM_TIFR0, SIM_TIFR1, SIM_TIFR2, SIM_PCIFR,
+    SIM_TWCR, SIM_UCSR0A, SIM_UDR0,
+    // Board-side outputs of the 74HC595 chain (not MCU registers), one
+    // byte per register, so devices can watch them like a port
+    SIM_SR0, SIM_SR1, SIM_SR2, SIM_SR3,
+    SIM_NUM_REGS
+} SimReg_t;
+
+typedef enum {
+    SIM_TCNT1, SIM_OCR1A, SIM_OCR1B, SIM_ICR1, SIM_UBRR0,
+    SIM_NUM_REGS16
+} SimReg16_t;
+
+extern volatile uint8_t sim_regs[SIM_NUM_REGS];
+extern volatile uint16_t sim_regs16[SIM_NUM_REGS16];
+
+// Synchronise devices and pending interrupts, then return the register
+volatile uint8_t *sim_io(SimReg_t reg);
+volatile uint16_t *sim_io16(SimReg16_t reg);
+
+// UDR0: the simulated USART only transmits, so every access is taken as
+// a write of whatever the register holds at the next synchronisation
+volatile uint8_t *sim_udr0(void);
+
+// Intrinsics
+void sim_delay_cycles(uint64_t cycles);
+void sim_nop(void);
+void sim_set_interrupts(uint8_t enable);
+void sim_sleep(void);
+
+// Watchdog: timeout code as in WDTO_*, 0xFF turns it off
+void sim_wdt_enable(uint8_t timeout);
+void sim_wdt_reset(void);
+
+#endif // SIM_HAL_H
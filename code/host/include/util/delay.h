@@ -0,0 +1,16 @@
+#ifndef SIM_UTIL_DELAY_H
+#define SIM_UTIL_DELAY_H
+
+// Host stand-in for <util/delay.h>: delays advance simulated time
+
+#include "sim_hal.h"
+
+static inline void _delay_us(double us) {
+    sim_delay_cycles((uint64_t)(us * (F_CPU / 1000000.0)));
+}
+
+static inline void _delay_ms(double ms) {
+    sim_delay_cycles((uint64_t)(ms * (F_CPU / 1000.0)));
+}
+
+#endif // SIM_UTIL_DELAY_H
@@ -0,0 +1,89 @@
+#ifndef SIM_H
+#define SIM_H
+
+// Host simulation of the SmartPark board: register file, virtual time,
+// interrupt dispatch and the devices hanging off the ATmega328P.
+
+#include <stdint.h>
+#include <setjmp.h>
+#include "sim_hal.h"
+
+#define SIM_CPU_HZ            16000000ULL
+#define SIM_US(us)            ((uint64_t)(us) * (SIM_CPU_HZ / 1000000ULL))
+#define SIM_MS(ms)            ((uint64_t)(ms) * (SIM_CPU_HZ / 1000ULL))
+#define SIM_NEVER             UINT64_MAX
+
+// Cycles charged for each synchronising register access, so polling
+// loops make progress in simulated time
+#define SIM_ACCESS_CYCLES     4
+
+// TIFR1 is presented with unused bit 7 set, so a write-one-to-clear shows
+// up as the bit missing at the next synchronisation
+#define SIM_TIFR1_POISON      0x80
+
+// Time spent in one interrupt handler, in the cycle model: entry and RETI
+// plus SIM_ACCESS_CYCLES per register access
+typedef struct {
+    const char *name;
+    uint32_t count;
+    uint64_t cycles;
+    uint64_t max_cycles;
+} SimIsrStats_t;
+
+// --- Core ---
+uint64_t sim_now(void);
+void sim_run(void (*firmware_entry)(void), uint64_t stop_at);
+void sim_at(uint64_t when, void (*action)(void *arg), void *arg);
+void sim_set_pin(SimReg_t pin_reg, uint8_t bit, uint8_t level);
+uint64_t sim_sleep_cycles(void);
+void sim_hang(void);
+uint64_t sim_watchdog_reset_at(void);
+const SimIsrStats_t *sim_isr_stats(uint8_t vector);
+
+// --- TWI master + PCF8574 backpack + HD44780 (sim_twi_lcd.c) ---
+#define SIM_LCD_ADDR          0x27
+
+// TWCR is presented with reserved bit 1 set. Firmware writes full values
+// that never include it, so a cleared bit marks a write to act on, even
+// when the value written equals the one read.
+#define SIM_TWCR_POISON       0x02
+
+void sim_twi_write_twcr(uint8_t value);
+uint64_t sim_twi_next_event(void);
+void sim_twi_event(void);
+uint8_t sim_twi_irq_pending(void);
+void sim_twi_refresh(void);
+
+const char *sim_lcd_row(uint8_t row);
+uint32_t sim_twi_bytes(void);
+uint32_t sim_twi_transactions(void);
+uint32_t sim_lcd_timing_violations(void);
+uint32_t sim_lcd_updates(void);
+
+// --- HC-SR04 sensors (sim_sonar.c) ---
+#define SIM_MAX_SONARS        24
+
+int sim_sonar_add(SimReg_t trig_port, uint8_t trig_bit, SimReg_t echo_pin, uint8_t echo_bit);
+void sim_sonar_set_distance_cm(int id, double cm);
+void sim_sonar_check_triggers(void);
+uint64_t sim_sonar_next_event(void);
+void sim_sonar_event(void);
+uint32_t sim_sonar_pings(int id);
+uint64_t sim_sonar_max_gap(int id);
+double sim_sonar_ping_rate(int id);
+
+// --- USART transmitter (sim_usart.c) ---
+void sim_usart_write_udr(uint8_t value);
+uint64_t sim_usart_next_event(void);
+void sim_usart_event(void);
+uint8_t sim_usart_udre_pending(void);
+uint8_t sim_usart_take_txc(void);
+void sim_usart_refresh(void);
+void sim_usart_set_output(int fd);
+uint32_t sim_usart_bytes(void);
+
+// --- 74HC595 output chain (sim_shiftreg.c) ---
+void sim_shiftreg_attach(SimReg_t port, uint8_t data, uint8_t clock, uint8_t latch);
+void sim_shiftreg_check(void);
+
+#endif // SIM_H
@@ -0,0 +1,480 @@
+#include "sim.h"
+#include <avr/io.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Register file shared with the firmware (see sim_hal.h)
+volatile uint8_t sim_regs[SIM_NUM_REGS];
+volatile uint16_t sim_regs16[SIM_NUM_REGS16];
+
+// Firmware interrupt handlers; vectors a build does not define stay NULL
+#define SIM_WEAK __attribute__((weak))
+extern void sim_vect_pcint0(void) SIM_WEAK;
+extern void sim_vect_pcint1(void) SIM_WEAK;
+extern void sim_vect_pcint2(void) SIM_WEAK;
+extern void sim_vect_timer1_compa(void) SIM_WEAK;
+extern void sim_vect_timer1_compb(void) SIM_WEAK;
+extern void sim_vect_timer1_ovf(void) SIM_WEAK;
+extern void sim_vect_timer0_compa(void) SIM_WEAK;
+extern void sim_vect_usart_udre(void) SIM_WEAK;
+extern void sim_vect_usart_tx(void) SIM_WEAK;
+extern void sim_vect_twi(void) SIM_WEAK;
+
+// Flag-driven vectors in AVR priority order. The flag is cleared when the
+// vector is taken, as the hardware does.
+typedef struct {
+    void (*handler)(void);
+    SimReg_t flag_reg;
+    uint8_t flag_bit;
+    SimReg_t enable_reg;
+    uint8_t enable_bit;
+} SimVector_t;
+
+static const SimVector_t vectors[] = {
+    { sim_vect_pcint0,       SIM_PCIFR, PCIF0, SIM_PCICR,  PCIE0  },
+    { sim_vect_pcint1,       SIM_PCIFR, PCIF1, SIM_PCICR,  PCIE1  },
+    { sim_vect_pcint2,       SIM_PCIFR, PCIF2, SIM_PCICR,  PCIE2  },
+    { sim_vect_timer1_compa, SIM_TIFR1, OCF1A, SIM_TIMSK1, OCIE1A },
+    { sim_vect_timer1_compb, SIM_TIFR1, OCF1B, SIM_TIMSK1, OCIE1B },
+    { sim_vect_timer1_ovf,   SIM_TIFR1, TOV1,  SIM_TIMSK1, TOIE1  },
+    { sim_vect_timer0_compa, SIM_TIFR0, OCF0A, SIM_TIMSK0, OCIE0A },
+};
+#define NUM_VECTORS (sizeof(vectors) / sizeof(vectors[0]))
+
+// Cycles for interrupt entry plus RETI
+#define SIM_ISR_CYCLES 10
+
+// Cycles spent in each handler, entry and RETI included
+static void (*const isr_handlers[])(void) = {
+    sim_vect_pcint0, sim_vect_pcint1, sim_vect_pcint2, sim_vect_timer1_compa,
+    sim_vect_timer1_compb, sim_vect_timer1_ovf, sim_vect_timer0_compa,
+    sim_vect_usart_udre, sim_vect_usart_tx, sim_vect_twi,
+};
+static SimIsrStats_t isr_stats[] = {
+    { "PCINT0" }, { "PCINT1" }, { "PCINT2" }, { "TIMER1_COMPA" },
+    { "TIMER1_COMPB" }, { "TIMER1_OVF" }, { "TIMER0_COMPA" },
+    { "USART_UDRE" }, { "USART_TX" }, { "TWI" },
+};
+#define NUM_HANDLERS (sizeof(isr_handlers) / sizeof(isr_handlers[0]))
+
+// Scripted actions (sim_at)
+#define SIM_MAX_ACTIONS 64
+
+typedef struct {
+    uint64_t when;
+    void (*action)(void *arg);
+    void *arg;
+} SimAction_t;
+
+static SimAction_t actions[SIM_MAX_ACTIONS];
+static uint8_t action_count = 0;
+
+// Core state
+static uint64_t now = 0;
+static uint64_t stop_at = SIM_NEVER;
+static jmp_buf stop_jmp;
+static uint8_t in_isr = 0;
+static uint32_t isr_count = 0;
+static uint64_t sleep_cycles = 0;
+static uint8_t udr0_accessed = 0;
+static uint8_t hung = 0;
+
+// Watchdog (WDTO_* timeouts, nominal 128 kHz oscillator)
+static uint64_t wdt_period = 0;
+static uint64_t wdt_deadline = SIM_NEVER;
+static uint64_t wdt_fired_at = SIM_NEVER;
+
+// Timer0 (CTC on OCR0A)
+static uint8_t t0_tccr0a = 0;
+static uint8_t t0_tccr0b = 0;
+static uint8_t t0_ocr0a = 0;
+static uint64_t t0_period = 0;
+static uint64_t t0_next = SIM_NEVER;
+
+// Timer1 (normal mode, compare match A)
+static uint8_t t1_tccr1b = 0;
+static uint32_t t1_prescale = 0;
+static uint64_t t1_base = 0;
+static uint64_t t1_next_ovf = SIM_NEVER;
+static uint16_t t1_ocr1a = 0;
+static uint64_t t1_next_compa = SIM_NEVER;
+static uint8_t t1_tifr = 0;     // TIFR1 as last shown to the firmware
+
+static const uint16_t prescalers[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+static void sim_dispatch(void);
+
+uint64_t sim_now(void) {
+    return now;
+}
+
+// --- Timers ---
+
+static void timer0_sync_config(void) {
+    uint32_t prescale;
+
+    if(sim_regs[SIM_TCCR0A] == t0_tccr0a && sim_regs[SIM_TCCR0B] == t0_tccr0b &&
+       sim_regs[SIM_OCR0A] == t0_ocr0a) {
+        return;
+    }
+    t0_tccr0a = sim_regs[SIM_TCCR0A];
+    t0_tccr0b = sim_regs[SIM_TCCR0B];
+    t0_ocr0a = sim_regs[SIM_OCR0A];
+
+    prescale = prescalers[t0_tccr0b & 0x07];
+    if(prescale && (t0_tccr0a & (1 << WGM01))) {
+        t0_period = (uint64_t)(t0_ocr0a + 1) * prescale;
+        t0_next = now + t0_period;
+    } else {
+        t0_next = SIM_NEVER;
+    }
+}
+
+static uint16_t timer1_count(void) {
+    if(!t1_prescale) return sim_regs16[SIM_TCNT1];
+    return (uint16_t)((now - t1_base) / t1_prescale);
+}
+
+// Next time TCNT1 reaches OCR1A. As on the chip, a match on the count the
+// timer already holds is blocked, so that one waits a full period.
+static void timer1_sync_compare(uint8_t force) {
+    uint64_t ticks;
+    uint16_t delta;
+
+    if(!force && sim_regs16[SIM_OCR1A] == t1_ocr1a) return;
+    t1_ocr1a = sim_regs16[SIM_OCR1A];
+
+    if(!t1_prescale) {
+        t1_next_compa = SIM_NEVER;
+        return;
+    }
+    ticks = (now - t1_base) / t1_prescale;
+    delta = (uint16_t)(t1_ocr1a - (uint16_t)ticks);
+    t1_next_compa = t1_base + (ticks + (delta ? delta : 0x10000)) * t1_prescale;
+}
+
+// TIFR1 bits are cleared by writing one (see SIM_TIFR1_POISON)
+static void timer1_sync_flags(void) {
+    uint8_t written = sim_regs[SIM_TIFR1];
+
+    if(written & SIM_TIFR1_POISON) return;
+    sim_regs[SIM_TIFR1] = t1_tifr & ~written;
+}
+
+static void timer1_sync_config(void) {
+    if(sim_regs[SIM_TCCR1B] == t1_tccr1b) return;
+    t1_tccr1b = sim_regs[SIM_TCCR1B];
+
+    t1_prescale = prescalers[t1_tccr1b & 0x07];
+    if(t1_prescale) {
+        t1_base = now;
+        t1_next_ovf = t1_base + 65536ULL * t1_prescale;
+    } else {
+        t1_next_ovf = SIM_NEVER;
+    }
+    timer1_sync_compare(1);
+}
+
+// --- Scheduling ---
+
+static uint64_t next_event(void) {
+    uint64_t next = stop_at;
+    uint64_t t;
+
+    if(t0_next < next) next = t0_next;
+    if(t1_next_ovf < next) next = t1_next_ovf;
+    if(t1_next_compa < next) next = t1_next_compa;
+    if(wdt_deadline < next) next = wdt_deadline;
+    if((t = sim_usart_next_event()) < next) next = t;
+    if((t = sim_twi_next_event()) < next) next = t;
+    if((t = sim_sonar_next_event()) < next) next = t;
+    if(action_count && actions[0].when < next) next = actions[0].when;
+    return next;
+}
+
+static void run_events(void) {
+    SimAction_t act;
+    uint8_t i;
+
+    while(t0_next <= now) {
+        sim_regs[SIM_TIFR0] |= (1 << OCF0A);
+        t0_next += t0_period;
+    }
+    while(t1_next_ovf <= now) {
+        sim_regs[SIM_TIFR1] |= (1 << TOV1);
+        t1_next_ovf += 65536ULL * t1_prescale;
+    }
+    while(t1_next_compa <= now) {
+        sim_regs[SIM_TIFR1] |= (1 << OCF1A);
+        t1_next_compa += 65536ULL * t1_prescale;
+    }
+    if(wdt_deadline <= now) {
+        // System reset: the run ends here, as on the board everything
+        // below would start over from the reset vector
+        wdt_fired_at = now;
+        sim_regs[SIM_MCUSR] |= (1 << WDRF);
+        longjmp(stop_jmp, 1);
+    }
+    while(sim_usart_next_event() <= now) {
+        sim_usart_event();
+    }
+    while(sim_twi_next_event() <= now) {
+        sim_twi_event();
+    }
+    while(sim_sonar_next_event() <= now) {
+        sim_sonar_event();
+    }
+    while(action_count && actions[0].when <= now) {
+        act = actions[0];
+        for(i = 1; i < action_count; i++) {
+            actions[i - 1] = actions[i];
+        }
+        action_count--;
+        act.action(act.arg);
+    }
+}
+
+// Pick up firmware writes made since the last synchronisation
+static void process_writes(void) {
+    timer0_sync_config();
+    timer1_sync_flags();
+    timer1_sync_config();
+    timer1_sync_compare(0);
+    if(udr0_accessed) {
+        udr0_accessed = 0;
+        sim_usart_write_udr(sim_regs[SIM_UDR0]);
+    }
+    if(!(sim_regs[SIM_TWCR] & SIM_TWCR_POISON)) {
+        sim_twi_write_twcr(sim_regs[SIM_TWCR]);
+    }
+    sim_shiftreg_check();
+    sim_sonar_check_triggers();
+}
+
+// Bring time-derived register values up to date
+static void refresh(void) {
+    sim_regs16[SIM_TCNT1] = timer1_count();
+    t1_tifr = sim_regs[SIM_TIFR1] & ~SIM_TIFR1_POISON;
+    sim_regs[SIM_TIFR1] = t1_tifr | SIM_TIFR1_POISON;
+    sim_usart_refresh();
+    sim_twi_refresh();
+}
+
+static void advance_to(uint64_t target) {
+    uint64_t next;
+
+    while(now < target) {
+        next = next_event();
+        if(next > target) next = target;
+        if(next < now) next = now;
+        if(next >= stop_at) {
+            now = stop_at;
+            longjmp(stop_jmp, 1);
+        }
+        now = next;
+        run_events();
+        refresh();
+        sim_dispatch();
+    }
+}
+
+static void (*take_vector(void))(void) {
+    uint8_t i;
+    const SimVector_t *v;
+
+    for(i = 0; i < NUM_VECTORS; i++) {
+        v = &vectors[i];
+        if((sim_regs[v->flag_reg] & (1 << v->flag_bit)) &&
+           (sim_regs[v->enable_reg] & (1 << v->enable_bit))) {
+            sim_regs[v->flag_reg] &= ~(1 << v->flag_bit);
+            if(v->handler) return v->handler;
+        }
+    }
+    // Level-triggered and self-clearing sources, in vector order
+    if(sim_usart_udre_pending() && sim_vect_usart_udre) {
+        return sim_vect_usart_udre;
+    }
+    if(sim_usart_take_txc() && sim_vect_usart_tx) {
+        return sim_vect_usart_tx;
+    }
+    if(sim_twi_irq_pending() && sim_vect_twi) {
+        return sim_vect_twi;  // TWINT is cleared by the handler, not on entry
+    }
+    return NULL;
+}
+
+static void isr_account(void (*handler)(void), uint64_t cycles) {
+    uint8_t i;
+
+    for(i = 0; i < NUM_HANDLERS; i++) {
+        if(isr_handlers[i] == handler) {
+            isr_stats[i].count++;
+            isr_stats[i].cycles += cycles;
+            if(cycles > isr_stats[i].max_cycles) isr_stats[i].max_cycles = cycles;
+            return;
+        }
+    }
+}
+
+static void sim_dispatch(void) {
+    void (*handler)(void);
+    uint64_t entered;
+
+    if(in_isr) return;
+
+    while((sim_regs[SIM_SREG] & (1 << SREG_I)) && (handler = take_vector()) != NULL) {
+        in_isr = 1;
+        isr_count++;
+        sim_regs[SIM_SREG] &= ~(1 << SREG_I);
+        entered = now;
+        advance_to(now + SIM_ISR_CYCLES);
+        handler();
+        isr_account(handler, now - entered);
+        sim_regs[SIM_SREG] |= (1 << SREG_I);
+        in_isr = 0;
+        process_writes();
+        refresh();
+    }
+}
+
+static void sync(uint64_t cost) {
+    // A hung firmware never gets past its next register access; only
+    // interrupts and the watchdog still run
+    if(hung && !in_isr) advance_to(stop_at);
+    process_writes();
+    refresh();
+    sim_dispatch();
+    advance_to(now + cost);
+    refresh();
+}
+
+// --- Firmware-facing API (sim_hal.h) ---
+
+volatile uint8_t *sim_io(SimReg_t reg) {
+    sync(SIM_ACCESS_CYCLES);
+    return &sim_regs[reg];
+}
+
+volatile uint16_t *sim_io16(SimReg16_t reg) {
+    sync(SIM_ACCESS_CYCLES);
+    return &sim_regs16[reg];
+}
+
+volatile uint8_t *sim_udr0(void) {
+    sync(SIM_ACCESS_CYCLES);
+    udr0_accessed = 1;
+    return &sim_regs[SIM_UDR0];
+}
+
+void sim_delay_cycles(uint64_t cycles) {
+    sync(cycles);
+}
+
+void sim_nop(void) {
+    sync(SIM_ACCESS_CYCLES);
+}
+
+void sim_set_interrupts(uint8_t enable) {
+    sync(1);
+    if(enable) {
+        sim_regs[SIM_SREG] |= (1 << SREG_I);
+        sim_dispatch();
+    } else {
+        sim_regs[SIM_SREG] &= ~(1 << SREG_I);
+    }
+}
+
+// SLEEP: with SE set, stop until an interrupt has been taken. An interrupt
+// already pending wakes the core at once, as after "sei; sleep".
+void sim_sleep(void) {
+    uint32_t taken = isr_count;
+    uint64_t from;
+
+    sync(1);
+    if(!(sim_regs[SIM_SMCR] & (1 << SE)) || !(sim_regs[SIM_SREG] & (1 << SREG_I))) return;
+
+    from = now;
+    while(isr_count == taken) {
+        advance_to(next_event() > now ? next_event() : now + 1);
+    }
+    sleep_cycles += now - from;
+}
+
+void sim_wdt_enable(uint8_t timeout) {
+    sync(1);
+    if(timeout > 9) {
+        wdt_deadline = SIM_NEVER;
+        return;
+    }
+    wdt_period = SIM_MS(16) << timeout;
+    wdt_deadline = now + wdt_period;
+}
+
+void sim_wdt_reset(void) {
+    sync(1);
+    if(wdt_deadline != SIM_NEVER) wdt_deadline = now + wdt_period;
+}
+
+// --- Runner-facing API (sim.h) ---
+
+// Cycles spent in SLEEP (including the interrupts that ended it)
+uint64_t sim_sleep_cycles(void) {
+    return sleep_cycles;
+}
+
+// Make the firmware stop making progress, as if stuck in a loop
+void sim_hang(void) {
+    hung = 1;
+}
+
+// Handler statistics by vector number, NULL past the last one
+const SimIsrStats_t *sim_isr_stats(uint8_t vector) {
+    return vector < NUM_HANDLERS ? &isr_stats[vector] : NULL;
+}
+
+// Time the watchdog reset the board, or SIM_NEVER
+uint64_t sim_watchdog_reset_at(void) {
+    return wdt_fired_at;
+}
+
+// Drive an input pin and raise the matching pin-change flag
+void sim_set_pin(SimReg_t pin_reg, uint8_t bit, uint8_t level) {
+    uint8_t mask = (1 << bit);
+
+    if(((sim_regs[pin_reg] & mask) != 0) == (level != 0)) return;
+    sim_regs[pin_reg] ^= mask;
+
+    if(pin_reg == SIM_PINB && (sim_regs[SIM_PCMSK0] & mask)) {
+        sim_regs[SIM_PCIFR] |= (1 << PCIF0);
+    } else if(pin_reg == SIM_PINC && (sim_regs[SIM_PCMSK1] & mask)) {
+        sim_regs[SIM_PCIFR] |= (1 << PCIF1);
+    } else if(pin_reg == SIM_PIND && (sim_regs[SIM_PCMSK2] & mask)) {
+        sim_regs[SIM_PCIFR] |= (1 << PCIF2);
+    }
+}
+
+// Run an action at a given simulated time (kept sorted by time)
+void sim_at(uint64_t when, void (*action)(void *arg), void *arg) {
+    uint8_t i;
+
+    if(action_count >= SIM_MAX_ACTIONS) {
+        fprintf(stderr, "sim: too many scheduled actions\n");
+        exit(1);
+    }
+    i = action_count++;
+    while(i > 0 && actions[i - 1].when > when) {
+        actions[i] = actions[i - 1];
+        i--;
+    }
+    actions[i].when = when;
+    actions[i].action = action;
+    actions[i].arg = arg;
+}
+
+// Run the firmware until simulated time reaches stop_at
+void sim_run(void (*firmware_entry)(void), uint64_t stop) {
+    stop_at = stop;
+    if(setjmp(stop_jmp) == 0) {
+        firmware_entry();
+    }
+}
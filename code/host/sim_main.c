@@ -0,0 +1,489 @@
+// SmartPark host simulator: runs the unmodified firmware against the
+// simulated board and reports what the LCD and LEDs ended up showing.
+//
+// Usage: smartpark_sim [-t ms] [-d cm,cm,...] [-e ms:slot:cm]... [-v]
+//                      [-u file | -P] [-H ms] [-S file] [-R file] [-L ms]
+//                      [-B file]
+//   -t  simulated run time in milliseconds (default 5000)
+//   -d  initial distance per slot in cm (0 = nothing in range, -1 = sensor
+//       disconnected)
+//   -e  change one slot's distance at a given time (repeatable)
+//   -v  print the display every time it changes
+//   -u  write the bytes sent on the USART to a file
+//   -P  send the USART bytes to a new pseudo-terminal (name is printed)
+//   -H  hang the firmware at this time, so the watchdog resets it
+//   -S  write the warm-restart snapshot (.noinit RAM) to a file at the end
+//   -R  start from a snapshot file after a watchdog reset, as the board
+//       does when it comes back from one (warm restart)
+//   -L  fail (exit 1) unless every change from -e shows within this many
+//       ms of the car moving, and the firmware's latency tracker stays
+//       within it for every slot
+//   -B  write a JSON report of stage, interrupt and task timings, change
+//       to display times and bus traffic to a file (make bench)
+
+#define _GNU_SOURCE  // posix_openpt() and friends
+
+#include "sim.h"
+#include "gpio.h"
+#include "ultrasonic.h"
+#include "restart.h"
+#include "latency.h"
+#include "health.h"
+#include "sampler.h"
+#include "scheduler.h"
+#include "profile.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+extern int firmware_main(void);
+extern uint16_t first_occupancy_ms;
+extern uint8_t warm_start;
+extern uint32_t sweep_duration_us;
+extern uint16_t lcd_bytes_last_update;
+extern SensorMask_t slots_quarantined;
+
+#define MAX_EVENTS 32
+
+// ATmega328P supply current at 5 V, 16 MHz (datasheet typicals, MCU only)
+#define MCU_ACTIVE_MA   10.0
+#define MCU_IDLE_MA     2.5
+
+typedef struct {
+    int slot;
+    double cm;
+    uint64_t at;
+    uint64_t shown_at;          // Firmware recorded the change as out (SIM_NEVER = not yet)
+    uint16_t changes_before;    // Latency count of the slot when the event hit
+} DistanceEvent_t;
+
+// Board wiring, taken from the firmware's slot table
+typedef struct {
+    uint8_t trig_port;
+    uint8_t trig_pin;
+    uint8_t echo_port;
+    uint8_t echo_pin;
+    uint8_t led_port;
+    uint8_t led_pin;
+} SlotWiring_t;
+
+#define SIM_SLOT_WIRING(id, tp, tb, ep, eb, lp, lb) [id] = { tp, tb, ep, eb, lp, lb },
+static const SlotWiring_t wiring[NUM_SENSORS] = { SLOT_TABLE(SIM_SLOT_WIRING) };
+
+static const SimReg_t port_regs[] = { SIM_PORTB, SIM_PORTC, SIM_PORTD };
+static const SimReg_t pin_regs[] = { SIM_PINB, SIM_PINC, SIM_PIND };
+
+// Register and bit an output lands on: a port pin or a 74HC595 output
+static SimReg_t output_reg(uint8_t port, uint8_t pin) {
+    if(port == SLOT_PORT_SHIFTREG) return SIM_SR0 + pin / 8;
+    return port_regs[port];
+}
+
+static uint8_t output_bit(uint8_t port, uint8_t pin) {
+    return (port == SLOT_PORT_SHIFTREG) ? pin % 8 : pin;
+}
+
+static DistanceEvent_t events[MAX_EVENTS];
+static int event_count = 0;
+static char last_rows[2][17];
+
+static void run_firmware(void) {
+    restart_capture_cause();   // .init3 on the board
+    firmware_main();
+}
+
+static void hang_firmware(void *arg) {
+    (void)arg;
+    sim_hang();
+}
+
+static void apply_distance(void *arg) {
+    DistanceEvent_t *ev = arg;
+    sim_sonar_set_distance_cm(ev->slot, ev->cm);
+#if LATENCY_ENABLED
+    ev->changes_before = latency_slots[ev->slot].count;
+#endif
+}
+
+#if LATENCY_ENABLED
+// Every millisecond: an event is out once the firmware has measured a new
+// change on its slot (it does so when the LEDs, LCD and telemetry are done)
+static void watch_latency(void *arg) {
+    int i;
+
+    (void)arg;
+    for(i = 0; i < event_count; i++) {
+        if(events[i].shown_at == SIM_NEVER && sim_now() > events[i].at &&
+           latency_slots[events[i].slot].count != events[i].changes_before) {
+            events[i].shown_at = sim_now();
+        }
+    }
+    sim_at(sim_now() + SIM_MS(1), watch_latency, NULL);
+}
+#endif
+
+// Machine-readable summary for make bench. The simulation is
+// deterministic, so the same build gives the same report and two builds
+// can be diffed. Stage times come from the profiler (PROFILE_ENABLED) and
+// cover the whole run as long as no dump restarted the window.
+static void write_bench_report(const char *path, double run_ms, double total_rate,
+                               double asleep) {
+#if PROFILE_ENABLED
+    static const char *const stage_names[] = { "sweep", "fsm", "leds", "lcd" };
+    ProfileReport_t report;
+#endif
+    const SimIsrStats_t *isr;
+    const char *sep = "";
+    FILE *f = fopen(path, "w");
+    int i;
+
+    if(!f) {
+        perror(path);
+        exit(1);
+    }
+    fprintf(f, "{\n  \"slots\": %d, \"strategy\": %d, \"run_ms\": %.0f,\n",
+            NUM_SENSORS, MEASURE_STRATEGY, run_ms);
+#if PROFILE_ENABLED
+    fprintf(f, "  \"stages_us\": {\n");
+    for(i = 0; i < PROFILE_STAGES; i++) {
+        profile_report(i + 1, &report);
+        fprintf(f, "    \"%s\": {\"count\": %u, \"min\": %lu, \"mean\": %lu, \"max\": %lu}%s\n",
+                stage_names[i], report.count, (unsigned long)report.min_us,
+                (unsigned long)report.mean_us, (unsigned long)report.max_us,
+                i < PROFILE_STAGES - 1 ? "," : "");
+    }
+    fprintf(f, "  },\n");
+#endif
+    fprintf(f, "  \"isr_cycles\": {\n");
+    for(i = 0; (isr = sim_isr_stats(i)) != NULL; i++) {
+        if(!isr->count) continue;
+        fprintf(f, "%s    \"%s\": {\"count\": %u, \"mean\": %llu, \"max\": %llu}", sep,
+                isr->name, isr->count, (unsigned long long)(isr->cycles / isr->count),
+                (unsigned long long)isr->max_cycles);
+        sep = ",\n";
+    }
+    fprintf(f, "\n  },\n  \"tasks\": [");
+    for(i = 0; i < scheduler_task_count(); i++) {
+        fprintf(f, "%s{\"runs\": %u, \"wcet_us\": %lu}", i ? ", " : "",
+                scheduler_run_count(i), (unsigned long)scheduler_wcet_us(i));
+    }
+    fprintf(f, "],\n");
+#if LATENCY_ENABLED
+    // From the moment the car moved to the LEDs and LCD showing it
+    fprintf(f, "  \"change_to_display_ms\": [");
+    for(i = 0; i < event_count; i++) {
+        fprintf(f, "%s{\"slot\": %d, \"at\": %.0f, ", i ? ", " : "", events[i].slot,
+                events[i].at / (double)SIM_MS(1));
+        if(events[i].shown_at == SIM_NEVER) {
+            fprintf(f, "\"after\": null}");
+        } else {
+            fprintf(f, "\"after\": %.1f}", (events[i].shown_at - events[i].at) / (double)SIM_MS(1));
+        }
+    }
+    fprintf(f, "],\n");
+#endif
+    fprintf(f, "  \"sweep_us\": %lu, \"measurements_per_s\": %.1f, \"first_occupancy_ms\": %u,\n",
+            (unsigned long)sweep_duration_us, total_rate, first_occupancy_ms);
+    fprintf(f, "  \"twi_bytes\": %u, \"lcd_bytes_last_update\": %u, \"usart_bytes\": %u,\n",
+            sim_twi_bytes(), lcd_bytes_last_update, sim_usart_bytes());
+    fprintf(f, "  \"sleep_fraction\": %.3f\n}\n", asleep);
+    fclose(f);
+}
+
+static void print_display(void) {
+    printf("+----------------+\n");
+    printf("|%s|\n", sim_lcd_row(0));
+    printf("|%s|\n", sim_lcd_row(1));
+    printf("+----------------+\n");
+}
+
+// Sample the display every millisecond and print it when it changes
+static void trace_display(void *arg) {
+    (void)arg;
+    if(strcmp(last_rows[0], sim_lcd_row(0)) || strcmp(last_rows[1], sim_lcd_row(1))) {
+        strcpy(last_rows[0], sim_lcd_row(0));
+        strcpy(last_rows[1], sim_lcd_row(1));
+        printf("t=%.3fms\n", sim_now() / (double)SIM_MS(1));
+        print_display();
+    }
+    sim_at(sim_now() + SIM_MS(1), trace_display, NULL);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-t ms] [-d cm,cm,...] [-e ms:slot:cm]... [-v] [-u file | -P] "
+            "[-H ms] [-S file] [-R file] [-L ms] [-B file]\n", prog);
+    exit(2);
+}
+
+// The snapshot as raw bytes, the way it sits in RAM across a reset
+static void save_snapshot(const char *path) {
+    FILE *f = fopen(path, "wb");
+
+    if(!f || fwrite(&restart_snapshot, sizeof(restart_snapshot), 1, f) != 1) {
+        perror(path);
+        exit(1);
+    }
+    fclose(f);
+}
+
+static void load_snapshot(const char *path) {
+    FILE *f = fopen(path, "rb");
+
+    if(!f || fread(&restart_snapshot, sizeof(restart_snapshot), 1, f) != 1) {
+        fprintf(stderr, "%s: not a snapshot from this build\n", path);
+        exit(1);
+    }
+    fclose(f);
+}
+
+// Master side of a new pseudo-terminal; a decoder can open the slave like
+// a real serial port
+static int open_pty(void) {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if(fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+        perror("pty");
+        exit(1);
+    }
+    printf("usart: %s\n", ptsname(fd));
+    fflush(stdout);
+    return fd;
+}
+
+int main(int argc, char **argv) {
+    double run_ms = 5000;
+    uint8_t trace = 0;
+    char *tok;
+    int slot;
+    int opt;
+    double at_ms;
+    int usart_fd = -1;
+    const char *snapshot_out = NULL;
+    const char *bench_out = NULL;
+    double budget_ms = 0;
+    double out_ms;
+    int failed = 0;
+    double total_rate;
+    double asleep;
+    int i;
+
+    for(i = 0; i < NUM_SENSORS; i++) {
+        sim_sonar_add(output_reg(wiring[i].trig_port, wiring[i].trig_pin),
+                      output_bit(wiring[i].trig_port, wiring[i].trig_pin),
+                      pin_regs[wiring[i].echo_port], wiring[i].echo_pin);
+        sim_sonar_set_distance_cm(i, 100);
+    }
+    sim_regs[SIM_MCUSR] = (1 << PORF);  // Power-on reset
+
+#if SHIFTREG_ENABLED
+    sim_shiftreg_attach(port_regs[SHIFTREG_GPIO_PORT], SHIFTREG_DATA_PIN,
+                        SHIFTREG_CLOCK_PIN, SHIFTREG_LATCH_PIN);
+#endif
+
+    while((opt = getopt(argc, argv, "t:d:e:vu:PH:S:R:L:B:")) != -1) {
+        switch(opt) {
+            case 't':
+                run_ms = atof(optarg);
+                break;
+            case 'd':
+                slot = 0;
+                for(tok = strtok(optarg, ","); tok && slot < NUM_SENSORS; tok = strtok(NULL, ",")) {
+                    sim_sonar_set_distance_cm(slot++, atof(tok));
+                }
+                break;
+            case 'e':
+                if(event_count >= MAX_EVENTS ||
+                   sscanf(optarg, "%lf:%d:%lf", &at_ms, &events[event_count].slot,
+                          &events[event_count].cm) != 3) {
+                    usage(argv[0]);
+                }
+                events[event_count].at = SIM_MS(at_ms);
+                events[event_count].shown_at = SIM_NEVER;
+                sim_at(SIM_MS(at_ms), apply_distance, &events[event_count]);
+                event_count++;
+                break;
+            case 'v':
+                trace = 1;
+                break;
+            case 'u':
+                usart_fd = open(optarg, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if(usart_fd < 0) {
+                    perror(optarg);
+                    exit(1);
+                }
+                break;
+            case 'P':
+                usart_fd = open_pty();
+                break;
+            case 'H':
+                sim_at(SIM_MS(atof(optarg)), hang_firmware, NULL);
+                break;
+            case 'S':
+                snapshot_out = optarg;
+                break;
+            case 'R':
+                load_snapshot(optarg);
+                sim_regs[SIM_MCUSR] = (1 << WDRF);
+                break;
+            case 'L':
+                budget_ms = atof(optarg);
+                break;
+            case 'B':
+                bench_out = optarg;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if(trace) {
+        sim_at(0, trace_display, NULL);
+    }
+#if LATENCY_ENABLED
+    if(budget_ms > 0 || bench_out) {
+        sim_at(0, watch_latency, NULL);
+    }
+#endif
+    sim_usart_set_output(usart_fd);
+
+    sim_run(run_firmware, (uint64_t)(run_ms * SIM_MS(1)));
+
+    printf("t=%.3fms\n", sim_now() / (double)SIM_MS(1));
+    print_display();
+    if(sim_watchdog_reset_at() != SIM_NEVER) {
+        printf("watchdog_reset_ms=%.3f\n", sim_watchdog_reset_at() / (double)SIM_MS(1));
+    }
+
+    printf("leds:");
+    for(i = 0; i < NUM_SENSORS; i++) {
+        printf(" %d", (sim_regs[output_reg(wiring[i].led_port, wiring[i].led_pin)] >>
+                       output_bit(wiring[i].led_port, wiring[i].led_pin)) & 0x01);
+    }
+    printf("\n");
+
+    printf("pings:");
+    for(i = 0; i < NUM_SENSORS; i++) {
+        printf(" %u", sim_sonar_pings(i));
+    }
+    printf("\n");
+
+    // Sampling: effective measurement rate and worst staleness per slot
+    total_rate = 0;
+    printf("ping_gap_max_ms:");
+    for(i = 0; i < NUM_SENSORS; i++) {
+        printf(" %.0f", sim_sonar_max_gap(i) / (double)SIM_MS(1));
+        total_rate += sim_sonar_ping_rate(i);
+    }
+    printf("\nmeasurements_per_s=%.1f\n", total_rate);
+
+    // The same seen from the firmware: its measurement count, the longest
+    // gap it recorded per slot and the slots it has on the slow rate
+    printf("measurements=%lu\nstaleness_max_ms:", (unsigned long)sampler_measurement_count());
+    for(i = 0; i < NUM_SENSORS; i++) {
+        printf(" %u", sampler_max_staleness_ms(i));
+    }
+    printf("\nsettled:");
+    for(i = 0; i < NUM_SENSORS; i++) {
+        printf(" %d", (sampler_settled() & SENSOR_MASK(i)) != 0);
+    }
+    printf("\n");
+    printf("sweep_us=%u\n", sweep_duration_us);
+
+#if HEALTH_ENABLED
+    // Sensor health: who is out of the sweep now, and how often each was
+    printf("quarantined:");
+    for(i = 0; i < NUM_SENSORS; i++) {
+        printf(" %d", (slots_quarantined & SENSOR_MASK(i)) != 0);
+    }
+    printf("\nquarantines:");
+    for(i = 0; i < NUM_SENSORS; i++) {
+        printf(" %u", health_sensors[i].quarantines);
+    }
+    printf("\n");
+#endif
+
+    printf("twi_bytes=%u twi_transactions=%u lcd_timing_violations=%u\n",
+           sim_twi_bytes(), sim_twi_transactions(), sim_lcd_timing_violations());
+    printf("lcd_bytes_last_update=%u\n", lcd_bytes_last_update);
+
+    // Scheduler: runs and longest run of each task, in the order main()
+    // added them
+    printf("task_runs:");
+    for(i = 0; i < scheduler_task_count(); i++) {
+        printf(" %u", scheduler_run_count(i));
+    }
+    printf("\ntask_wcet_us:");
+    for(i = 0; i < scheduler_task_count(); i++) {
+        printf(" %lu", (unsigned long)scheduler_wcet_us(i));
+    }
+    printf("\n");
+    printf("usart_bytes=%u\n", sim_usart_bytes());
+
+    // Power: time asleep and the MCU supply current that implies
+    asleep = (double)sim_sleep_cycles() / sim_now();
+    printf("first_occupancy_ms=%u\n", first_occupancy_ms);
+    printf("sleep_fraction=%.3f mcu_ma_est=%.2f\n", asleep,
+           asleep * MCU_IDLE_MA + (1 - asleep) * MCU_ACTIVE_MA);
+
+#if LATENCY_ENABLED
+    // Detection latency as the firmware measured it: changes, worst case
+    printf("latency_changes:");
+    for(i = 0; i < NUM_SENSORS; i++) {
+        printf(" %u", latency_slots[i].count);
+    }
+    printf("\nlatency_max_ms:");
+    for(i = 0; i < NUM_SENSORS; i++) {
+        printf(" %u", latency_slots[i].max_ms);
+    }
+    printf("\n");
+
+    // Each event from the moment the car moved, which is what a driver
+    // sees; the firmware's own figure starts later, at the first echo.
+    // Both must stay within the budget.
+    if(budget_ms > 0) {
+        for(i = 0; i < event_count; i++) {
+            slot = events[i].slot;
+            if(events[i].shown_at == SIM_NEVER) {
+                printf("latency: slot %d change at %.0fms never shown\n", slot,
+                       events[i].at / (double)SIM_MS(1));
+                failed = 1;
+                continue;
+            }
+            out_ms = (events[i].shown_at - events[i].at) / (double)SIM_MS(1);
+            printf("latency: slot %d change at %.0fms out after %.0fms%s\n", slot,
+                   events[i].at / (double)SIM_MS(1), out_ms,
+                   out_ms > budget_ms ? " OVER BUDGET" : "");
+            if(out_ms > budget_ms) {
+                failed = 1;
+            }
+        }
+        for(i = 0; i < NUM_SENSORS; i++) {
+            if(latency_slots[i].max_ms > budget_ms) {
+                printf("latency: slot %d firmware max %ums OVER BUDGET\n", i,
+                       latency_slots[i].max_ms);
+                failed = 1;
+            }
+        }
+        printf("latency_budget=%.0fms %s\n", budget_ms, failed ? "FAIL" : "ok");
+    }
+#endif
+
+    if(bench_out) {
+        write_bench_report(bench_out, run_ms, total_rate, asleep);
+    }
+
+    // Restart: how this run started and what it leaves for the next one
+    printf("warm_start=%u warm_restarts=%u watchdog_resets=%u\n", warm_start,
+           restart_snapshot.warm_restarts, restart_snapshot.watchdog_resets);
+    if(snapshot_out) {
+        save_snapshot(snapshot_out);
+    }
+
+    if(usart_fd >= 0) {
+        close(usart_fd);
+    }
+
+    return failed;
+}
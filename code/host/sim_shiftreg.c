@@ -0,0 +1,46 @@
+#include "sim.h"
+
+// 74HC595 chain: SER is sampled on the SRCLK rising edge, RCLK rising
+// edge copies the shift stages to the outputs (SIM_SR0 = first register)
+
+static uint8_t attached = 0;
+static SimReg_t port_reg;
+static uint8_t data_bit;
+static uint8_t clock_bit;
+static uint8_t latch_bit;
+static uint8_t last_clock = 0;
+static uint8_t last_latch = 0;
+static uint32_t stages = 0;
+
+void sim_shiftreg_attach(SimReg_t port, uint8_t data, uint8_t clock, uint8_t latch) {
+    port_reg = port;
+    data_bit = data;
+    clock_bit = clock;
+    latch_bit = latch;
+    attached = 1;
+}
+
+// Look for clock and latch edges written by the firmware
+void sim_shiftreg_check(void) {
+    uint8_t value;
+    uint8_t clock;
+    uint8_t latch;
+
+    if(!attached) return;
+
+    value = sim_regs[port_reg];
+    clock = (value >> clock_bit) & 0x01;
+    latch = (value >> latch_bit) & 0x01;
+
+    if(clock && !last_clock) {
+        stages = (stages << 1) | ((value >> data_bit) & 0x01);
+    }
+    if(latch && !last_latch) {
+        sim_regs[SIM_SR0] = stages & 0xFF;
+        sim_regs[SIM_SR1] = (stages >> 8) & 0xFF;
+        sim_regs[SIM_SR2] = (stages >> 16) & 0xFF;
+        sim_regs[SIM_SR3] = (stages >> 24) & 0xFF;
+    }
+    last_clock = clock;
+    last_latch = latch;
+}
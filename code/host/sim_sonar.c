@@ -0,0 +1,144 @@
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// HC-SR04 timing model
+#define SONAR_MIN_TRIGGER_CYCLES  SIM_US(10)     // Shortest accepted trigger pulse
+#define SONAR_BURST_US            460            // Trigger fall -> echo rise
+#define SONAR_US_PER_CM           58.0           // Round trip
+#define SONAR_NO_ECHO_US          38000          // Echo width with nothing in range
+
+typedef struct {
+    SimReg_t trig_port;
+    uint8_t trig_bit;
+    SimReg_t echo_pin;
+    uint8_t echo_bit;
+    double distance_cm;       // 0 = nothing in range, < 0 = disconnected (no echo)
+    uint8_t trig_level;
+    uint64_t trig_rise_at;
+    uint64_t echo_rise_at;
+    uint64_t echo_fall_at;
+    uint32_t pings;
+    uint64_t first_ping_at;
+    uint64_t last_ping_at;
+    uint64_t max_gap;         // Longest time between two pings
+} SimSonar_t;
+
+static SimSonar_t sonars[SIM_MAX_SONARS];
+static int sonar_count = 0;
+
+// Register a sensor wired to the given trigger output and echo input
+int sim_sonar_add(SimReg_t trig_port, uint8_t trig_bit, SimReg_t echo_pin, uint8_t echo_bit) {
+    SimSonar_t *s;
+
+    if(sonar_count >= SIM_MAX_SONARS) {
+        fprintf(stderr, "sim: too many sonars\n");
+        exit(1);
+    }
+    s = &sonars[sonar_count];
+    s->trig_port = trig_port;
+    s->trig_bit = trig_bit;
+    s->echo_pin = echo_pin;
+    s->echo_bit = echo_bit;
+    s->distance_cm = 0;
+    s->trig_level = 0;
+    s->echo_rise_at = SIM_NEVER;
+    s->echo_fall_at = SIM_NEVER;
+    s->pings = 0;
+    s->max_gap = 0;
+    return sonar_count++;
+}
+
+// Takes effect from the next ping
+void sim_sonar_set_distance_cm(int id, double cm) {
+    if(id < 0 || id >= sonar_count) return;
+    sonars[id].distance_cm = cm;
+}
+
+// Look for trigger edges written by the firmware
+void sim_sonar_check_triggers(void) {
+    uint64_t now = sim_now();
+    SimSonar_t *s;
+    uint8_t level;
+    double echo_us;
+    int i;
+
+    for(i = 0; i < sonar_count; i++) {
+        s = &sonars[i];
+        level = (sim_regs[s->trig_port] >> s->trig_bit) & 0x01;
+        if(level == s->trig_level) continue;
+        s->trig_level = level;
+
+        if(level) {
+            s->trig_rise_at = now;
+            continue;
+        }
+
+        // Falling edge: a long enough pulse starts a ping unless one is
+        // still in progress
+        if(now - s->trig_rise_at < SONAR_MIN_TRIGGER_CYCLES) continue;
+        if(s->echo_rise_at != SIM_NEVER || s->echo_fall_at != SIM_NEVER) continue;
+
+        if(s->distance_cm >= 0) {
+            echo_us = (s->distance_cm > 0) ? s->distance_cm * SONAR_US_PER_CM : SONAR_NO_ECHO_US;
+            s->echo_rise_at = now + SIM_US(SONAR_BURST_US);
+            s->echo_fall_at = s->echo_rise_at + (uint64_t)(echo_us * (SIM_CPU_HZ / 1000000.0));
+        }
+        if(s->pings == 0) {
+            s->first_ping_at = now;
+        } else if(now - s->last_ping_at > s->max_gap) {
+            s->max_gap = now - s->last_ping_at;
+        }
+        s->last_ping_at = now;
+        s->pings++;
+    }
+}
+
+uint64_t sim_sonar_next_event(void) {
+    uint64_t next = SIM_NEVER;
+    int i;
+
+    for(i = 0; i < sonar_count; i++) {
+        if(sonars[i].echo_rise_at < next) next = sonars[i].echo_rise_at;
+        if(sonars[i].echo_fall_at < next) next = sonars[i].echo_fall_at;
+    }
+    return next;
+}
+
+void sim_sonar_event(void) {
+    uint64_t now = sim_now();
+    SimSonar_t *s;
+    int i;
+
+    for(i = 0; i < sonar_count; i++) {
+        s = &sonars[i];
+        if(s->echo_rise_at <= now) {
+            sim_set_pin(s->echo_pin, s->echo_bit, 1);
+            s->echo_rise_at = SIM_NEVER;
+        }
+        if(s->echo_fall_at <= now && s->echo_rise_at == SIM_NEVER) {
+            sim_set_pin(s->echo_pin, s->echo_bit, 0);
+            s->echo_fall_at = SIM_NEVER;
+        }
+    }
+}
+
+uint32_t sim_sonar_pings(int id) {
+    if(id < 0 || id >= sonar_count) return 0;
+    return sonars[id].pings;
+}
+
+// Longest time between two pings of a sensor, in cycles
+uint64_t sim_sonar_max_gap(int id) {
+    if(id < 0 || id >= sonar_count) return 0;
+    return sonars[id].max_gap;
+}
+
+// Pings per second since the sensor's first ping
+double sim_sonar_ping_rate(int id) {
+    SimSonar_t *s;
+
+    if(id < 0 || id >= sonar_count || sonars[id].pings < 2) return 0;
+    s = &sonars[id];
+    return (s->pings - 1) * (double)SIM_CPU_HZ / (s->last_ping_at - s->first_ping_at);
+}
@@ -0,0 +1,224 @@
+#include "sim.h"
+#include <avr/io.h>
+#include <util/twi.h>
+#include <string.h>
+
+// --- TWI master ---
+
+typedef enum {
+    TWI_OP_NONE,
+    TWI_OP_START,
+    TWI_OP_BYTE
+} TwiOp_t;
+
+static uint8_t twcr_hw = 0;             // TWCR as the hardware sees it
+static TwiOp_t pending_op = TWI_OP_NONE;
+static uint64_t op_done_at = SIM_NEVER;
+static uint64_t stop_done_at = SIM_NEVER;
+static uint8_t bus_owned = 0;
+static uint8_t expect_address = 0;
+static uint8_t slave_selected = 0;
+static uint8_t tx_byte = 0;
+
+static uint32_t bytes_sent = 0;
+static uint32_t transactions = 0;
+
+// --- PCF8574 backpack + HD44780 ---
+
+#define PCF_RS        0x01
+#define PCF_E         0x04
+
+#define LCD_EXEC_SHORT_US  37
+#define LCD_EXEC_DATA_US   41
+#define LCD_EXEC_LONG_US   1520
+
+static uint8_t pcf_out = 0;
+static uint8_t ddram[128] = { [0 ... 127] = ' ' };
+static uint8_t ddram_addr = 0;
+static uint8_t four_bit = 0;
+static uint8_t have_high_nibble = 0;
+static uint8_t high_nibble = 0;
+static uint64_t lcd_busy_until = 0;
+static uint32_t timing_violations = 0;
+static uint32_t lcd_writes = 0;
+static char row_text[2][17];
+
+// SCL period in CPU cycles: 16 + 2 * TWBR * 4^TWPS
+static uint64_t scl_cycles(void) {
+    static const uint8_t twps[4] = { 1, 4, 16, 64 };
+    return 16 + 2ULL * sim_regs[SIM_TWBR] * twps[sim_regs[SIM_TWSR] & 0x03];
+}
+
+static void set_status(uint8_t status) {
+    sim_regs[SIM_TWSR] = status | (sim_regs[SIM_TWSR] & 0x03);
+    twcr_hw |= (1 << TWINT);
+}
+
+static void lcd_execute(uint8_t rs, uint8_t value) {
+    uint32_t exec_us = LCD_EXEC_SHORT_US;
+
+    if(rs) {
+        ddram[ddram_addr & 0x7F] = value;
+        ddram_addr++;
+        exec_us = LCD_EXEC_DATA_US;
+        lcd_writes++;
+    } else if(value & 0x80) {
+        ddram_addr = value & 0x7F;           // Set DDRAM address
+    } else if(value & 0x40) {
+        // Set CGRAM address: custom glyphs are not modelled
+    } else if(value & 0x20) {
+        four_bit = !(value & 0x10);          // Function set (DL bit)
+        have_high_nibble = 0;
+    } else if(value == 0x01) {
+        memset(ddram, ' ', sizeof(ddram));   // Clear display
+        ddram_addr = 0;
+        exec_us = LCD_EXEC_LONG_US;
+        lcd_writes++;
+    } else if((value & 0xFE) == 0x02) {
+        ddram_addr = 0;                      // Return home
+        exec_us = LCD_EXEC_LONG_US;
+    }
+
+    lcd_busy_until = sim_now() + SIM_US(exec_us);
+}
+
+// Falling edge of E latches D7..D4
+static void lcd_latch(uint8_t bus) {
+    uint8_t rs = bus & PCF_RS;
+    uint8_t nibble = bus & 0xF0;
+
+    if(sim_now() < lcd_busy_until) {
+        timing_violations++;
+    }
+
+    if(!four_bit) {
+        lcd_execute(rs, nibble);  // 8-bit interface, D3..D0 not wired
+        return;
+    }
+    if(!have_high_nibble) {
+        high_nibble = nibble;
+        have_high_nibble = 1;
+        return;
+    }
+    have_high_nibble = 0;
+    lcd_execute(rs, high_nibble | (nibble >> 4));
+}
+
+static void pcf_write(uint8_t value) {
+    uint8_t previous = pcf_out;
+
+    pcf_out = value;
+    if((previous & PCF_E) && !(value & PCF_E)) {
+        lcd_latch(value);
+    }
+}
+
+// Firmware wrote TWCR
+void sim_twi_write_twcr(uint8_t value) {
+    uint64_t now = sim_now();
+
+    twcr_hw = (value & ~((1 << TWINT) | SIM_TWCR_POISON)) | (twcr_hw & (1 << TWINT));
+
+    if(!(value & (1 << TWINT)) || !(value & (1 << TWEN))) {
+        return;
+    }
+    twcr_hw &= ~(1 << TWINT);  // Writing one clears the flag and starts the operation
+
+    if(value & (1 << TWSTO)) {
+        bus_owned = 0;
+        stop_done_at = now + scl_cycles();
+        if(value & (1 << TWSTA)) {
+            pending_op = TWI_OP_START;
+            op_done_at = stop_done_at + scl_cycles();
+        }
+    } else if(value & (1 << TWSTA)) {
+        pending_op = TWI_OP_START;
+        op_done_at = now + scl_cycles();
+    } else {
+        pending_op = TWI_OP_BYTE;
+        tx_byte = sim_regs[SIM_TWDR];
+        op_done_at = now + 9 * scl_cycles();  // 8 data bits + ACK
+    }
+}
+
+uint64_t sim_twi_next_event(void) {
+    return (stop_done_at < op_done_at) ? stop_done_at : op_done_at;
+}
+
+void sim_twi_event(void) {
+    uint64_t now = sim_now();
+
+    if(stop_done_at <= now) {
+        twcr_hw &= ~(1 << TWSTO);
+        stop_done_at = SIM_NEVER;
+    }
+    if(op_done_at > now) return;
+    op_done_at = SIM_NEVER;
+
+    switch(pending_op) {
+        case TWI_OP_START:
+            set_status(bus_owned ? TW_REP_START : TW_START);
+            bus_owned = 1;
+            expect_address = 1;
+            transactions++;
+            break;
+
+        case TWI_OP_BYTE:
+            bytes_sent++;
+            if(expect_address) {
+                expect_address = 0;
+                slave_selected = ((tx_byte >> 1) == SIM_LCD_ADDR) && !(tx_byte & 0x01);
+                set_status(slave_selected ? TW_MT_SLA_ACK : TW_MT_SLA_NACK);
+            } else if(slave_selected) {
+                pcf_write(tx_byte);
+                set_status(TW_MT_DATA_ACK);
+            } else {
+                set_status(TW_MT_DATA_NACK);
+            }
+            break;
+
+        default:
+            break;
+    }
+    pending_op = TWI_OP_NONE;
+}
+
+uint8_t sim_twi_irq_pending(void) {
+    return (twcr_hw & (1 << TWINT)) && (twcr_hw & (1 << TWIE));
+}
+
+void sim_twi_refresh(void) {
+    sim_regs[SIM_TWCR] = twcr_hw | SIM_TWCR_POISON;
+}
+
+// Visible text of one display row (16 characters)
+const char *sim_lcd_row(uint8_t row) {
+    uint8_t base = row ? 0x40 : 0x00;
+    uint8_t i;
+    uint8_t c;
+
+    row = row ? 1 : 0;
+    for(i = 0; i < 16; i++) {
+        c = ddram[base + i];
+        row_text[row][i] = (c >= 0x20 && c < 0x7F) ? (char)c : '?';
+    }
+    row_text[row][16] = '\0';
+    return row_text[row];
+}
+
+uint32_t sim_twi_bytes(void) {
+    return bytes_sent;
+}
+
+uint32_t sim_twi_transactions(void) {
+    return transactions;
+}
+
+uint32_t sim_lcd_timing_violations(void) {
+    return timing_violations;
+}
+
+// Data writes and clears executed by the controller
+uint32_t sim_lcd_updates(void) {
+    return lcd_writes;
+}
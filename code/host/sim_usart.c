@@ -0,0 +1,96 @@
+#include "sim.h"
+#include <avr/io.h>
+#include <errno.h>
+#include <unistd.h>
+
+// USART0 transmitter: UDR0 buffer + shift register, 8N1 frame timing from
+// UBRR0 and U2X0. Transmitted bytes are copied to an output descriptor.
+
+static uint8_t data_full = 0;           // UDR0 holds a byte not yet shifting
+static uint8_t data_byte = 0;
+static uint8_t shifting = 0;
+static uint8_t shift_byte = 0;
+static uint64_t shift_done_at = SIM_NEVER;
+static uint8_t txc = 0;
+
+static int output_fd = -1;
+static uint32_t bytes_sent = 0;
+static uint32_t bytes_lost = 0;         // Output sink not keeping up
+
+static uint64_t byte_cycles(void) {
+    uint32_t ubrr = ((uint32_t)(sim_regs[SIM_UBRR0H] & 0x0F) << 8) | sim_regs[SIM_UBRR0L];
+    uint32_t per_bit = (ubrr + 1) * ((sim_regs[SIM_UCSR0A] & (1 << U2X0)) ? 8 : 16);
+
+    return 10ULL * per_bit;  // Start + 8 data + stop
+}
+
+static void start_shift(uint8_t value) {
+    shifting = 1;
+    shift_byte = value;
+    shift_done_at = sim_now() + byte_cycles();
+}
+
+// Firmware wrote UDR0
+void sim_usart_write_udr(uint8_t value) {
+    if(!(sim_regs[SIM_UCSR0B] & (1 << TXEN0))) return;
+
+    if(!shifting) {
+        start_shift(value);
+    } else if(!data_full) {
+        data_full = 1;
+        data_byte = value;
+    }
+    // Writing while UDRE0 is clear is lost, as on the hardware
+}
+
+uint64_t sim_usart_next_event(void) {
+    return shift_done_at;
+}
+
+void sim_usart_event(void) {
+    if(shift_done_at > sim_now()) return;
+    shift_done_at = SIM_NEVER;
+    shifting = 0;
+    bytes_sent++;
+
+    if(output_fd >= 0 && write(output_fd, &shift_byte, 1) != 1) {
+        bytes_lost++;
+    }
+
+    if(data_full) {
+        data_full = 0;
+        start_shift(data_byte);
+    } else {
+        txc = 1;
+    }
+}
+
+uint8_t sim_usart_udre_pending(void) {
+    return !data_full && (sim_regs[SIM_UCSR0B] & (1 << UDRIE0)) &&
+           (sim_regs[SIM_UCSR0B] & (1 << TXEN0));
+}
+
+// TXC0 is cleared when its vector is taken
+uint8_t sim_usart_take_txc(void) {
+    if(txc && (sim_regs[SIM_UCSR0B] & (1 << TXCIE0))) {
+        txc = 0;
+        return 1;
+    }
+    return 0;
+}
+
+void sim_usart_refresh(void) {
+    uint8_t status = sim_regs[SIM_UCSR0A] & ~((1 << UDRE0) | (1 << TXC0));
+
+    if(!data_full) status |= (1 << UDRE0);
+    if(txc) status |= (1 << TXC0);
+    sim_regs[SIM_UCSR0A] = status;
+}
+
+void sim_usart_set_output(int fd) {
+    output_fd = fd;
+}
+
+uint32_t sim_usart_bytes(void) {
+    return bytes_sent;
+}
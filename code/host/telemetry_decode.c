@@ -0,0 +1,206 @@
+// SmartPark telemetry decoder: reads frames from a file, a pipe or a
+// serial port and prints one line per frame.
+//
+// Usage: telemetry_decode [file|tty]     (default: stdin)
+//   A tty is switched to raw 115200 8N1 before reading.
+
+#define _GNU_SOURCE  // cfmakeraw()
+
+#include "telemetry_proto.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+typedef struct {
+    unsigned long frames;
+    unsigned long crc_errors;
+    unsigned long bad_length;
+    unsigned long seq_gaps;
+    int last_seq[256];          // Per node, -1 = none seen yet
+} DecodeStats_t;
+
+static DecodeStats_t stats;
+
+// Profiler stages, by PROFILE_STAGE_* number
+static const char *const stage_names[] = { "?", "sweep", "fsm", "leds", "lcd" };
+
+static void raw_tty(int fd) {
+    struct termios tio;
+
+    if(tcgetattr(fd, &tio) < 0) return;  // Not a terminal
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tcsetattr(fd, TCSANOW, &tio);
+}
+
+static unsigned get_le16(const uint8_t *p) {
+    return p[0] | ((unsigned)p[1] << 8);
+}
+
+static unsigned long get_le32(const uint8_t *p) {
+    return get_le16(p) | ((unsigned long)get_le16(p + 2) << 16);
+}
+
+static unsigned long get_mask(const uint8_t *p, uint8_t bytes) {
+    unsigned long mask = 0;
+    uint8_t i;
+
+    for(i = 0; i < bytes; i++) {
+        mask |= (unsigned long)p[i] << (8 * i);
+    }
+    return mask;
+}
+
+// Slot 0 first, as on the LCD map
+static void print_mask(const char *name, unsigned long mask, uint8_t slots) {
+    uint8_t i;
+
+    printf(" %s=", name);
+    for(i = 0; i < slots; i++) {
+        putchar((mask >> i) & 1 ? '1' : '0');
+    }
+}
+
+// frame[0] is the length byte; returns 0 if the payload is inconsistent
+static int print_frame(const uint8_t *frame) {
+    uint8_t len = frame[0];
+    uint8_t type = frame[1] & TELEM_TYPE_MASK;
+    uint8_t node = frame[2];
+    uint8_t seq = frame[3];
+    uint8_t slots = frame[4];
+    uint8_t mask_bytes = TELEM_MASK_BYTES(slots);
+    uint8_t expect = TELEM_HEADER_LEN - 2 + 2 * mask_bytes;
+    const uint8_t *p = &frame[5];
+    uint8_t i;
+
+    if(type == TELEM_TYPE_HEARTBEAT) expect += 4;
+    if(type == TELEM_TYPE_BOOT) expect += 2;
+    if(type == TELEM_TYPE_PROFILE) expect += TELEM_PROFILE_LEN;
+    if(type == TELEM_TYPE_LATENCY) expect += TELEM_LATENCY_LEN;
+    if(frame[1] & TELEM_FLAG_QUARANTINE) expect += mask_bytes;
+    if(frame[1] & TELEM_FLAG_PULSES) expect += 2 * slots;
+    if(slots > TELEM_MAX_SLOTS || len != expect) return 0;
+
+    if(stats.last_seq[node] >= 0 && seq != (uint8_t)(stats.last_seq[node] + 1)) {
+        stats.seq_gaps++;
+    }
+    stats.last_seq[node] = seq;
+
+    printf("node=%u seq=%u %s slots=%u", node, seq,
+           type == TELEM_TYPE_STATE ? "state" :
+           type == TELEM_TYPE_HEARTBEAT ? "heartbeat" :
+           type == TELEM_TYPE_BOOT ? "boot" :
+           type == TELEM_TYPE_PROFILE ? "profile" :
+           type == TELEM_TYPE_LATENCY ? "latency" : "unknown", slots);
+    print_mask("occupied", get_mask(p, mask_bytes), slots);
+    p += mask_bytes;
+    print_mask("error", get_mask(p, mask_bytes), slots);
+    p += mask_bytes;
+    if(frame[1] & TELEM_FLAG_QUARANTINE) {
+        print_mask("quarantined", get_mask(p, mask_bytes), slots);
+        p += mask_bytes;
+    }
+
+    if(type == TELEM_TYPE_HEARTBEAT) {
+        printf(" uptime=%us asleep=%u.%u%%", get_le16(p), get_le16(p + 2) / 10, get_le16(p + 2) % 10);
+        p += 4;
+    } else if(type == TELEM_TYPE_BOOT) {
+        printf(" first_valid=%ums%s", get_le16(p), (frame[1] & TELEM_FLAG_WARM) ? " warm" : "");
+        p += 2;
+    } else if(type == TELEM_TYPE_PROFILE) {
+        printf(" stage=%s n=%u min=%luus mean=%luus max=%luus hist=",
+               p[0] < sizeof(stage_names) / sizeof(stage_names[0]) ? stage_names[p[0]] : "?",
+               get_le16(p + 1), get_le32(p + 3), get_le32(p + 7), get_le32(p + 11));
+        p += 15;
+        for(i = 0; i < TELEM_PROFILE_BUCKETS; i++, p += 2) {
+            printf("%s%u", i ? "," : "", get_le16(p));
+        }
+    } else if(type == TELEM_TYPE_LATENCY) {
+        printf(" slot=%u n=%u last=%ums max=%ums hist=", p[0], get_le16(p + 1),
+               get_le16(p + 3), get_le16(p + 5));
+        p += 7;
+        for(i = 0; i < TELEM_LATENCY_BUCKETS; i++, p++) {
+            printf("%s%u", i ? "," : "", p[0]);
+        }
+    }
+    if(frame[1] & TELEM_FLAG_PULSES) {
+        printf(" pulses=");
+        for(i = 0; i < slots; i++, p += 2) {
+            printf("%s%u", i ? "," : "", get_le16(p));
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    uint8_t frame[TELEM_MAX_FRAME];
+    uint8_t have = 0;         // Bytes collected after SYNC
+    uint8_t need = 0;
+    uint16_t crc;
+    uint8_t c;
+    uint8_t i;
+    int fd = STDIN_FILENO;
+    int node;
+
+    if(argc > 2) {
+        fprintf(stderr, "usage: %s [file|tty]\n", argv[0]);
+        return 2;
+    }
+    if(argc == 2) {
+        fd = open(argv[1], O_RDONLY | O_NOCTTY);
+        if(fd < 0) {
+            perror(argv[1]);
+            return 1;
+        }
+        raw_tty(fd);
+    }
+    for(node = 0; node < 256; node++) {
+        stats.last_seq[node] = -1;
+    }
+
+    // Hunt for SYNC, then collect the length byte and length + CRC bytes.
+    // A bad frame is dropped and the hunt starts again.
+    while(read(fd, &c, 1) == 1) {
+        if(need == 0) {
+            if(c == TELEM_SYNC) {
+                have = 0;
+                need = 1;
+            }
+            continue;
+        }
+
+        frame[have++] = c;
+        if(have == 1) {
+            if(c < TELEM_HEADER_LEN - 2 || c > TELEM_MAX_FRAME - 4) {
+                stats.bad_length++;
+                need = 0;
+            } else {
+                need = 1 + c + TELEM_CRC_LEN;
+            }
+            continue;
+        }
+        if(have < need) continue;
+        need = 0;
+
+        crc = TELEM_CRC_INIT;
+        for(i = 0; i < have - TELEM_CRC_LEN; i++) {
+            crc = telem_crc_update(crc, frame[i]);
+        }
+        if(crc != get_le16(&frame[have - TELEM_CRC_LEN])) {
+            stats.crc_errors++;
+        } else if(print_frame(frame)) {
+            stats.frames++;
+        } else {
+            stats.bad_length++;
+        }
+    }
+
+    printf("frames=%lu crc_errors=%lu bad_length=%lu seq_gaps=%lu\n",
+           stats.frames, stats.crc_errors, stats.bad_length, stats.seq_gaps);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "latency.h"
+
+#if LATENCY_ENABLED
+#include "clock.h"
+#include "telemetry.h"
+#include "usart.h"
+
+#define LATENCY_FRAME_LEN  (TELEM_HEADER_LEN + 3 * TELEM_MASK_BYTES(NUM_SENSORS) + \
+                            TELEM_LATENCY_LEN + TELEM_CRC_LEN)
+
+SlotLatency_t latency_slots[NUM_SENSORS];
+
+static SensorMask_t awaiting = 0;   // Shown by the FSM, outputs not finished
+static SensorMask_t report_due = 0; // New measurement not sent yet
+
+void latency_init(void) {
+    uint8_t i;
+
+    for(i = 0; i < NUM_SENSORS; i++) {
+        latency_slots[i].pending = LATENCY_NONE;
+        latency_slots[i].shown = LATENCY_FREE;  // As the FSM masks start out
+    }
+    awaiting = 0;
+    report_due = 0;
+}
+
+// A new reading of one slot, classified like the FSM does, and the clock
+// time it was taken
+void latency_reading(uint8_t slot, uint8_t state, uint32_t when) {
+    SlotLatency_t *s = &latency_slots[slot];
+
+    if(state == s->shown) {
+        s->pending = LATENCY_NONE;
+    } else if(state != s->pending) {
+        s->pending = state;
+        s->since = when;
+    }
+}
+
+// The FSM flipped these slots. A flip to the state the readings pointed
+// to starts waiting for the outputs; any other flip is not measured.
+void latency_shown(SensorMask_t changed, SensorMask_t occupied, SensorMask_t error) {
+    SlotLatency_t *s;
+    uint8_t state;
+    uint8_t i;
+
+    for(i = 0; changed; i++, changed >>= 1) {
+        if(!(changed & 0x01)) continue;
+
+        s = &latency_slots[i];
+        state = (error & SENSOR_MASK(i)) ? LATENCY_ERROR :
+                (occupied & SENSOR_MASK(i)) ? LATENCY_OCCUPIED : LATENCY_FREE;
+        s->shown = state;
+        if(s->pending == state) {
+            awaiting |= SENSOR_MASK(i);
+        } else {
+            awaiting &= ~SENSOR_MASK(i);
+        }
+        s->pending = LATENCY_NONE;
+    }
+}
+
+// Do not measure the changes these slots are waiting on (e.g. the first
+// picture after reset, which is timed as the boot time instead)
+void latency_discard(SensorMask_t slots) {
+    awaiting &= ~slots;
+}
+
+static void record(uint8_t slot, uint32_t now) {
+    SlotLatency_t *s = &latency_slots[slot];
+    uint32_t ms = (now - s->since) / CLOCK_MS_TO_TICKS(1);
+    uint8_t bucket = (ms >= LATENCY_BUDGET_MS) ? LATENCY_BUCKETS - 1 : ms / LATENCY_BUCKET_MS;
+    uint8_t i;
+
+    s->last_ms = (ms > 0xFFFF) ? 0xFFFF : (uint16_t)ms;
+    if(s->last_ms > s->max_ms) s->max_ms = s->last_ms;
+    if(s->count < UINT16_MAX) s->count++;
+
+    if(s->hist[bucket] == UINT8_MAX) {
+        for(i = 0; i < LATENCY_BUCKETS; i++) {
+            s->hist[i] >>= 1;
+        }
+    }
+    s->hist[bucket]++;
+    report_due |= SENSOR_MASK(slot);
+}
+
+// Call from the main loop with the slots whose shown state is fully out
+void latency_emitted(SensorMask_t settled) {
+    SensorMask_t done = awaiting & settled;
+    uint32_t now;
+    uint8_t i;
+
+    if(!done) return;
+    now = clock_now();
+    awaiting &= ~done;
+    for(i = 0; done; i++, done >>= 1) {
+        if(done & 0x01) {
+            record(i, now);
+        }
+    }
+}
+
+// Call from the main loop: sends one pending histogram once the USART
+// queue has room for it
+void latency_poll(SensorMask_t occupied, SensorMask_t error) {
+#if TELEMETRY_ENABLED
+    uint8_t i;
+
+    if(!report_due || usart_queue_free() < LATENCY_FRAME_LEN) return;
+
+    i = 0;
+    while(!(report_due & SENSOR_MASK(i))) {
+        i++;
+    }
+    report_due &= ~SENSOR_MASK(i);
+    telemetry_send_latency(occupied, error, i, &latency_slots[i]);
+#else
+    (void)occupied;
+    (void)error;
+    report_due = 0;
+#endif
+}
+
+#endif // LATENCY_ENABLED
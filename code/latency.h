@@ -0,0 +1,58 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include "slots.h"
+#include "telemetry_proto.h"
+
+// Detection Latency
+// Measures, per slot, how long a change takes to reach the outside world:
+// from the echo edge of the first reading that points to the new state
+// (for a missing echo, the end of that sweep) until the LEDs, the LCD
+// (bus idle) and telemetry (line idle) all show it. Readings that point
+// away from the shown state and then back restart the clock, so filter
+// noise is not counted. Each slot keeps a histogram of these times; with
+// telemetry, a TELEM_TYPE_LATENCY frame with the slot's histogram follows
+// every measurement.
+
+#ifndef LATENCY_ENABLED
+#define LATENCY_ENABLED    1
+#endif
+
+#define LATENCY_BUDGET_MS  1000     // Requirement: a change shows within 1 s
+#define LATENCY_BUCKET_MS  125      // Histogram bucket width
+#define LATENCY_BUCKETS    TELEM_LATENCY_BUCKETS  // The last one is over budget
+
+#if (LATENCY_BUCKETS - 1) * LATENCY_BUCKET_MS != LATENCY_BUDGET_MS
+#error "The last latency bucket must start at the budget"
+#endif
+
+typedef enum {
+    LATENCY_FREE,
+    LATENCY_OCCUPIED,
+    LATENCY_ERROR,
+    LATENCY_NONE
+} LatencyState_t;
+
+typedef struct {
+    uint32_t since;                 // Clock time of the first reading of the pending state
+    uint8_t pending;                // State the readings point to (LATENCY_NONE = as shown)
+    uint8_t shown;                  // State the FSM shows
+    uint16_t count;                 // Changes measured since reset
+    uint16_t last_ms;
+    uint16_t max_ms;
+    uint8_t hist[LATENCY_BUCKETS];  // Halved together when one fills up
+} SlotLatency_t;
+
+// Readable by the host simulator after a run
+extern SlotLatency_t latency_slots[NUM_SENSORS];
+
+// --- Public Function Prototypes ---
+void latency_init(void);
+void latency_reading(uint8_t slot, uint8_t state, uint32_t when);
+void latency_shown(SensorMask_t changed, SensorMask_t occupied, SensorMask_t error);
+void latency_discard(SensorMask_t slots);
+void latency_emitted(SensorMask_t settled);
+void latency_poll(SensorMask_t occupied, SensorMask_t error);
+
+#endif // LATENCY_H
@@ -1,73 +1,105 @@
 #include "lcd.h"
-#include <util/twi.h>
+#include "twi.h"
 #include <util/delay.h>
 
 #define LCD_BACKLIGHT 0x08   // Keeps backlight ON permanently
 #define LCD_ENABLE    0x04   // Enable pin bit mask
 #define LCD_RS        0x01   // Register Select (0 = Command, 1 = Data)
 
-
-// Send a START condition to begin I2C communication
-static void i2c_start(void) {
-    TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
-    while (!(TWCR & (1 << TWINT)));  // Wait until start completes
+// Shadow of the visible DDRAM and the frame being rendered for the next commit
+static uint8_t lcd_shadow[LCD_ROWS][LCD_COLS];
+static uint8_t lcd_frame[LCD_ROWS][LCD_COLS];
+static uint8_t cursor_row = 0;     // DDRAM address the LCD will write next
+static uint8_t cursor_col = 0;
+static uint8_t frame_row = 0;      // Render position inside lcd_frame
+static uint8_t frame_col = 0;
+static uint16_t tx_bytes = 0;      // Expander bytes queued since power-up
+static uint8_t burst_depth = 0;    // Nesting level of lcd_burst_begin()
+
+// Queues a half-byte (nibble) with control bits as an E high/low pair.
+// The TWI engine drains it in the background.
+static void lcd_send_nibble(uint8_t nibble, uint8_t control, uint8_t flags) {
+    uint8_t data = nibble | control | LCD_BACKLIGHT;  // Backlight always ON
+    tx_bytes += 2;
+    twi_enqueue(data | LCD_ENABLE, TWI_CONTINUE);     // Pulse the Enable line (E = 1)
+    twi_enqueue(data & ~LCD_ENABLE, flags);           // Latch command/data (E = 0)
 }
 
-// Send a STOP condition to end I2C communication
-static void i2c_stop(void) {
-    TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWSTO);
-    _delay_us(10);  // Small delay ensures bus release
+// Sends a full byte by splitting it into two nibbles. Both nibbles share one
+// transaction, which stays open while a burst is in progress.
+static void lcd_send_byte(uint8_t byte, uint8_t control) {
+    lcd_send_nibble(byte & 0xF0, control, TWI_CONTINUE);                  // Send high nibble
+    lcd_send_nibble((byte << 4) & 0xF0, control,
+                    burst_depth ? TWI_CONTINUE : TWI_END);                // Send low nibble
 }
 
-// Write one byte to the I2C bus
-static void i2c_write(uint8_t data) {
-    TWDR = data;
-    TWCR = (1 << TWINT) | (1 << TWEN);
-    while (!(TWCR & (1 << TWINT)));  // Wait for write completion
+// Start a burst: everything sent until lcd_burst_end() goes out in a
+// single I2C transaction with back-to-back E high/low pairs
+void lcd_burst_begin(void) {
+    burst_depth++;
 }
 
-// Sends a half-byte (nibble) with control bits
-static void lcd_send_nibble(uint8_t nibble, uint8_t control) {
-    uint8_t data = nibble | control | LCD_BACKLIGHT;  // Backlight always ON
-    i2c_start();
-    i2c_write(LCD_ADDR << 1);
-    i2c_write(data | LCD_ENABLE);  // Pulse the Enable line (E = 1)
-    _delay_us(1);
-    i2c_write(data & ~LCD_ENABLE); // Latch command/data (E = 0)
-    i2c_stop();
+// Finish a burst and release the bus after its last byte
+void lcd_burst_end(void) {
+    if (burst_depth > 0 && --burst_depth == 0) {
+        twi_mark_end();
+    }
 }
 
-// Sends a full byte by splitting it into two nibbles
-static void lcd_send_byte(uint8_t byte, uint8_t control) {
-    lcd_send_nibble(byte & 0xF0, control);           // Send high nibble
-    lcd_send_nibble((byte << 4) & 0xF0, control);    // Send low nibble
-}
 
+// Fill one row of a screen buffer with blanks
+static void lcd_blank_row(uint8_t row[LCD_COLS]) {
+    uint8_t i;
+
+    for(i = 0; i < LCD_COLS; i++) {
+        row[i] = ' ';
+    }
+}
 
 // Send a command (RS = 0) to configure LCD
 void lcd_command(uint8_t cmd) {
     lcd_send_byte(cmd, 0x00);
-    if (cmd == 0x01 || cmd == 0x02)
+
+    // Keep the shadow in step with what the controller does
+    if (cmd & 0x80) {
+        cursor_row = (cmd & 0x40) ? 1 : 0;
+        cursor_col = cmd & 0x3F;
+    } else if (cmd == 0x01 || cmd == 0x02) {
+        if (cmd == 0x01) {
+            lcd_blank_row(lcd_shadow[0]);
+            lcd_blank_row(lcd_shadow[1]);
+        }
+        cursor_row = 0;
+        cursor_col = 0;
+    }
+
+    if (cmd == 0x01 || cmd == 0x02) {
+        twi_flush();  // Command must reach the LCD before timing its execution
         _delay_ms(2); // Longer wait for clear/home commands
+    }
 }
 
 // Send data (RS = 1) to display a character
 void lcd_data(uint8_t data) {
     lcd_send_byte(data, LCD_RS);
+    if (cursor_col < LCD_COLS) {
+        lcd_shadow[cursor_row][cursor_col] = data;
+    }
+    cursor_col++;
 }
 
 // Initialize the LCD in 4-bit I2C mode
 void lcd_init(void) {
-    // Initialize I2C clock speed (100kHz standard mode)
-    TWSR = 0x00;
-    TWBR = 0x48;  // F_SCL = F_CPU / (16 + 2*TWBR) = 100kHz @ 16MHz
+    // Initialize I2C transmit engine (100kHz standard mode)
+    twi_init(LCD_ADDR);
     _delay_ms(50); // Wait for LCD power-up
 
     // 4-bit initialization sequence per HD44780 datasheet
-    lcd_send_nibble(0x30, 0x00); _delay_ms(5);
-    lcd_send_nibble(0x30, 0x00); _delay_us(150);
-    lcd_send_nibble(0x30, 0x00); _delay_us(150);
-    lcd_send_nibble(0x20, 0x00); // Set to 4-bit mode
+    // (flush before each wait so the delay starts after the nibble lands)
+    lcd_send_nibble(0x30, 0x00, TWI_END); twi_flush(); _delay_ms(5);
+    lcd_send_nibble(0x30, 0x00, TWI_END); twi_flush(); _delay_us(150);
+    lcd_send_nibble(0x30, 0x00, TWI_END); twi_flush(); _delay_us(150);
+    lcd_send_nibble(0x20, 0x00, TWI_END); // Set to 4-bit mode
 
     // Function Set: 4-bit mode, 2 lines, 5x8 font
     lcd_command(0x28);
@@ -77,7 +109,6 @@ void lcd_init(void) {
     lcd_command(0x06);
     // Clear Display
     lcd_command(0x01);
-    _delay_ms(2);
 }
 
 // Move cursor to specific row/column (0-based)
@@ -86,51 +117,103 @@ void lcd_set_cursor(uint8_t row, uint8_t col) {
     lcd_command(0x80 | pos);
 }
 
-// Print a string on the LCD
+// Print a string on the LCD as one transaction. 16 characters take
+// 5.9 ms on the bus at 100 kHz, against 9.4 ms sent as 32 transactions.
 void lcd_print(const char *str) {
+    lcd_burst_begin();
     while (*str) lcd_data(*str++);
+    lcd_burst_end();
 }
 
 // Clear the LCD screen
 void lcd_clear(void) {
-    lcd_command(0x01);
-    _delay_ms(2);
+    lcd_command(0x01);  // Waits for the clear to complete
+}
+
+// Block until all queued LCD traffic has been sent
+void lcd_flush(void) {
+    twi_flush();
 }
 
 
-void lcd_display_slots(uint8_t slots[], uint8_t total) {
-    static uint8_t is_full_displayed = 0; // Flag to remember if "FULL PARKING" is currently shown
-    uint8_t full = 0;                     // Counter for occupied slots
+// --- Framebuffer rendering ---
 
-    for (uint8_t i = 0; i < total; i++) {
-        full += slots[i];
-    }
+// Blank the frame and move the render position home
+void lcd_fb_clear(void) {
+    lcd_blank_row(lcd_frame[0]);
+    lcd_blank_row(lcd_frame[1]);
+    frame_row = 0;
+    frame_col = 0;
+}
+
+// Forget what the LCD shows so the next commit rewrites every cell
+void lcd_fb_invalidate(void) {
+    uint8_t row;
+    uint8_t col;
 
-    if (full == total) {
-        // Only update the display once when transitioning to FULL PARKING mode
-        if (!is_full_displayed) {
-            lcd_clear();
-            lcd_set_cursor(0, 2);
-            lcd_print("FULL PARKING");
-            is_full_displayed = 1; // Mark that full display is active
+    for (row = 0; row < LCD_ROWS; row++) {
+        for (col = 0; col < LCD_COLS; col++) {
+            lcd_shadow[row][col] = 0xFF;  // Never rendered, so always dirty
         }
-        return; // Skip normal slot display while parking is full
     }
+}
 
-    is_full_displayed = 0;   // Reset flag since not all slots are full
-    lcd_clear();             // Clear the LCD before writing new data
-    lcd_set_cursor(0, 0);    // Start at the top-left corner (row 0, col 0)
-
-    for (uint8_t i = 0; i < total; i++) {
-        lcd_print("P");           // Print slot prefix (e.g., P0)
-        lcd_data('0' + i);        // Print slot number
-        lcd_print(":");           // Separator
-        lcd_data('0' + slots[i]); // Print status (0 or 1)
-        lcd_print(" ");           // Add spacing for clarity
+// Move the render position (0-based)
+void lcd_fb_set_cursor(uint8_t row, uint8_t col) {
+    frame_row = (row < LCD_ROWS) ? row : LCD_ROWS - 1;
+    frame_col = col;
+}
 
-        // Move to second line after the third slot to fit 6 total (3 per row)
-        if (i == 2)
-            lcd_set_cursor(1, 0);
+// Render one character; text past the right edge is clipped
+void lcd_fb_putc(uint8_t c) {
+    if (frame_col < LCD_COLS) {
+        lcd_frame[frame_row][frame_col] = c;
     }
+    frame_col++;
+}
+
+// Render a string
+void lcd_fb_print(const char *str) {
+    while (*str) lcd_fb_putc(*str++);
 }
 
+// Send only the cells that differ from the shadow. Each dirty run costs one
+// cursor move; a single clean cell between two dirty ones is rewritten
+// instead, which costs the same as the move it saves. A character or
+// command is 4 expander bytes, so one changed cell costs 8 and a full
+// redraw 136 (32 cells plus a cursor move per row).
+// Returns the number of I2C expander bytes queued.
+uint16_t lcd_fb_commit(void) {
+    uint16_t start_bytes = tx_bytes;
+    uint8_t row;
+    uint8_t col;
+
+    for (row = 0; row < LCD_ROWS; row++) {
+        lcd_burst_begin();  // One transaction per row
+        col = 0;
+        while (col < LCD_COLS) {
+            if (lcd_frame[row][col] == lcd_shadow[row][col]) {
+                col++;
+                continue;
+            }
+
+            if (cursor_row != row || cursor_col != col) {
+                lcd_set_cursor(row, col);
+            }
+
+            while (col < LCD_COLS) {
+                if (lcd_frame[row][col] != lcd_shadow[row][col] ||
+                    (col + 1 < LCD_COLS &&
+                     lcd_frame[row][col + 1] != lcd_shadow[row][col + 1])) {
+                    lcd_data(lcd_frame[row][col]);
+                    col++;
+                } else {
+                    break;
+                }
+            }
+        }
+        lcd_burst_end();
+    }
+
+    return tx_bytes - start_bytes;
+}
@@ -6,6 +6,8 @@
 #include <stdint.h>
 
 #define LCD_ADDR 0x27
+#define LCD_ROWS 2
+#define LCD_COLS 16
 
 // --- Public Function Prototypes ---
 void lcd_init(void);
@@ -14,7 +16,17 @@ void lcd_data(uint8_t data);
 void lcd_set_cursor(uint8_t row, uint8_t col);
 void lcd_print(const char *str);
 void lcd_clear(void);
-void lcd_display_slots(uint8_t slots[], uint8_t total);
+void lcd_flush(void);
+void lcd_burst_begin(void);
+void lcd_burst_end(void);
 void lcd_print_number(uint16_t number);
 
+// --- Framebuffer API (render, then commit only the changed cells) ---
+void lcd_fb_clear(void);
+void lcd_fb_set_cursor(uint8_t row, uint8_t col);
+void lcd_fb_putc(uint8_t c);
+void lcd_fb_print(const char *str);
+uint16_t lcd_fb_commit(void);
+void lcd_fb_invalidate(void);
+
 #endif
@@ -1,297 +1,599 @@
 #include "gpio.h"
 #include "ultrasonic.h"
 #include "lcd.h"
+#include "scheduler.h"
+#include "clock.h"
+#include "profile.h"
+#include "telemetry.h"
+#include "filter.h"
+#include "sampler.h"
+#include "restart.h"
+#include "latency.h"
+#include "health.h"
+#include "twi.h"
+#include "usart.h"
 #include <avr/interrupt.h>
 #include <util/delay.h>
 
 // Constants
 #define DIST_THRESHOLD_CM 10      // Distance threshold for car detection
-#define UPDATE_INTERVAL_MS 150    // Time between measurements (150ms)
-#define LED_TEST_DELAY_MS  100    // Delay for LED test sequence
+#define DIST_THRESHOLD_TICKS CM_MAX_TICKS(DIST_THRESHOLD_CM)  // Same limit as a pulse width
+#define DIST_BORDER_TICKS  CM_TO_TICKS(3)  // Readings this close to the threshold keep a slot hot
 
-// FSM States for Each Slot
-typedef enum {
-    STATE_NO_CAR,
-    STATE_CAR_DETECTED,
-    STATE_ERROR
-} ParkingState_t;
+// Boot Profiles (select with -DBOOT_PROFILE=...)
+// Sensors start measuring at once in both; the showcase profile runs the
+// splash screens and LED test alongside as timed tasks.
+#define BOOT_SHOWCASE      0      // Splash screens and LED test (~5 s)
+#define BOOT_PRODUCTION    1      // Straight to the occupancy display
+
+#ifndef BOOT_PROFILE
+#define BOOT_PROFILE BOOT_SHOWCASE
+#endif
+
+#define STRINGIFY(x)       #x
+#define TO_STRING(x)       STRINGIFY(x)
+#if NUM_SENSORS < 10
+#define SENSORS_ACTIVE_TEXT TO_STRING(NUM_SENSORS) " Sensors Active"
+#else
+#define SENSORS_ACTIVE_TEXT TO_STRING(NUM_SENSORS) " Sensors Ready"
+#endif
+
+// Task Rates (each runs independently off the scheduler tick)
+#define SENSE_PERIOD_MS      SAMPLE_FAST_MS  // Time between measurement cycles
+#define FSM_PERIOD_MS        50     // Slot state evaluation
+#define LED_PERIOD_MS        50     // LED refresh
+#define LCD_PERIOD_MS        100    // LCD update check
+#define LCD_REFRESH_MS       10000  // Forced full repaint (safety measure)
+
+// Requirement: a slot change shows within 1 second. Worst case, the change
+// lands just after the slot's reading. Its next reading starts within a
+// sweep period, or SAMPLE_SLOW_MS plus the rounding to a sweep if it has
+// settled, and arrives up to SWEEP_WORST_MS later; the filter needs
+// FILTER_LAG_READINGS more sweeps, then the FSM and LCD run. A sweep
+// longer than SENSE_PERIOD_MS stretches the period to whole multiples.
+#define SWEEP_PERIOD_WORST_MS \
+    ((SWEEP_WORST_MS + SENSE_PERIOD_MS - 1) / SENSE_PERIOD_MS * SENSE_PERIOD_MS)
+#if SAMPLE_ADAPTIVE
+#define READING_WAIT_WORST_MS (SAMPLE_SLOW_MS - SAMPLE_FAST_MS + SWEEP_PERIOD_WORST_MS)
+#else
+#define READING_WAIT_WORST_MS SWEEP_PERIOD_WORST_MS
+#endif
+#ifndef FILTER_LAG_READINGS
+#error "No lag bound for this filter: define FILTER_LAG_READINGS (see filter.h)"
+#elif (READING_WAIT_WORST_MS + SWEEP_WORST_MS + FILTER_LAG_READINGS * SWEEP_PERIOD_WORST_MS + \
+       FSM_PERIOD_MS + LCD_PERIOD_MS > 1000)
+#error "Worst-case sweep too slow for the 1 second update requirement"
+#endif
 
 // Global Variables
-ParkingState_t slot_states[NUM_SENSORS] = {STATE_NO_CAR};
-uint16_t slot_distances[NUM_SENSORS] = {0};
-uint8_t slot_status[NUM_SENSORS] = {0};
-uint8_t measurement_cycle = 0;
+uint16_t slot_pulses[NUM_SENSORS] = {0};   // Filtered echo widths in Timer1 ticks (0 = invalid)
+uint8_t measurements_valid = 0;
 uint8_t system_ready = 0;
-uint8_t lcd_needs_update = 1;
+
+// Slot State (bit n = slot n)
+// A slot is free, occupied or in error (no valid echo); the FSM keeps these
+// masks up to date and accumulates every flipped bit into the changed
+// masks, which the LCD and LED tasks consume.
+SensorMask_t slots_occupied = 0;
+SensorMask_t slots_error = 0;
+SensorMask_t slots_quarantined = 0;   // Sensors out of the sweep (health.h), also in error
+SensorMask_t lcd_changed = 0;         // Slots to redraw on the LCD
+SensorMask_t leds_shown = 0;          // Occupancy the LEDs currently show
+uint8_t lcd_repaint = 1;              // Redraw the whole screen on the next update
+uint16_t lcd_bytes_last_update = 0;   // I2C bytes sent by the last LCD commit
+uint32_t sweep_duration_us = 0;       // Duration of the last measurement sweep
+SensorMask_t sweep_due = 0;           // Slots fired by the running sweep
+uint8_t sweep_in_flight = 0;          // Sweep started, readings not taken yet
+uint16_t sweep_started_ms = 0;
+uint8_t sweep_done_task = SCHED_INVALID;
+SensorMask_t slots_measured = 0;      // Slots with at least one reading since reset
+uint16_t first_occupancy_ms = 0;      // Reset -> first complete occupancy (0 = not yet)
+uint8_t boot_showing = (BOOT_PROFILE == BOOT_SHOWCASE);  // Boot screens own the LCD and LEDs
+uint8_t boot_task = SCHED_INVALID;
+uint8_t warm_start = 0;               // Resumed from the restart snapshot
 
 // Function Prototypes
 void system_init(void);
-void led_test_sequence(void);
-uint8_t perform_measurement_cycle(void);
+void resume_warm_state(void);
+void start_measurement_cycle(void);
+uint8_t finish_measurement_cycle(void);
+void sweep_complete(void);
 void update_fsm_all(void);
 void update_leds(void);
 void update_lcd_display(void);
-void convert_states_to_status(void);
-void display_startup_message(void);
-void display_system_status(void);
+void task_sense(void);
+void task_sweep_done(void);
+void task_fsm(void);
+void task_leds(void);
+void task_lcd(void);
+void task_lcd_refresh(void);
+#if TELEMETRY_ENABLED
+void task_heartbeat(void);
+#endif
+#if BOOT_PROFILE == BOOT_SHOWCASE
+void task_boot_screens(void);
+#endif
 
 // Initialize System
+// Nothing here waits: the sensors, timers and interrupts come up first so
+// the first sweep can run while the LCD is still powering up (see main).
 void system_init(void) {
-    // Initialize LCD first
-    lcd_init();
-    display_startup_message();
+    // Start the system clock (Timer1) used for echo timing
+    clock_init();
+    
+    // Initialize ultrasonic sensors and their reading filters
+    ultrasonic_init_all();
+    filter_init();
+    sampler_init();
+#if LATENCY_ENABLED
+    latency_init();
+#endif
+#if HEALTH_ENABLED
+    health_init();
+#endif
+    
+    // Start the task tick (Timer0)
+    scheduler_init();
     
     // Initialize LEDs
     led_init();
     
-    // Run LED test sequence
-    led_test_sequence();
-    
-    // Initialize ultrasonic sensors
-    ultrasonic_init_all();
+#if TELEMETRY_ENABLED
+    // Serial telemetry (USART pins are free in this layout)
+    telemetry_init();
+#endif
+#if PROFILE_ENABLED
+    profile_init();
+#endif
     
     // Disable SPI to free PB4 (D12) and PB5 (D13)
     SPCR &= ~(1 << SPE);
     
+    // Stop the clocks of unused peripherals: less current while awake and
+    // while idling in the scheduler (the ADC is already off after reset)
+    ACSR |= (1 << ACD);  // Analog comparator
+    PRR = (1 << PRADC) | (1 << PRSPI) | (1 << PRTIM2)
+#if !TELEMETRY_ENABLED
+        | (1 << PRUSART0)
+#endif
+        ;
+    
     // Enable global interrupts
     sei();
     
     system_ready = 1;
-    
-    display_system_status();
-    
-    _delay_ms(500);
-}
-
-// Display Startup Message
-void display_startup_message(void) {
-    lcd_clear();
-    lcd_set_cursor(0, 0);
-    lcd_print("SmartPark System");
-    lcd_set_cursor(1, 0);
-    lcd_print("Initializing...");
-    _delay_ms(1500);
-
-    lcd_clear();
-    lcd_set_cursor(0, 0);
-    lcd_print("By: Noe Setenta");
-    lcd_set_cursor(1, 0);
-    lcd_print("    Jah Cagula");
-    _delay_ms(1500);
 }
 
-// Display System Status
-void display_system_status(void) {
-    lcd_clear();
-    lcd_set_cursor(0, 0);
-    lcd_print("System Ready");
-    lcd_set_cursor(1, 0);
-    lcd_print("6 Sensors Active");
-    _delay_ms(1000);
-}
-
-// LED Test Sequence
-void led_test_sequence(void) {
+// Resume After a Warm Restart
+// Puts back the readings and filter windows saved before the reset, so the
+// FSM has a complete picture at once and the next sweeps carry on from it
+// instead of refilling the filters.
+void resume_warm_state(void) {
+    const RestartState_t *saved = restart_state();
     uint8_t i;
-    uint8_t j;
-    
-    lcd_clear();
-    lcd_set_cursor(0, 0);
-    lcd_print("Testing LEDs...");
-    
-    // Quick LED test - all at once
-    for(j = 0; j < 2; j++) {
-        // All LEDs on
-        update_sensor_led(SENSOR_1, 5);  // Fake distance to turn on
-        update_sensor_led(SENSOR_2, 5);
-        update_sensor_led(SENSOR_3, 5);
-        update_sensor_led(SENSOR_4, 5);
-        update_sensor_led(SENSOR_5, 5);
-        update_sensor_led(SENSOR_6, 5);
-        _delay_ms(300);
-        
-        // All LEDs off
-        update_sensor_led(SENSOR_1, 20);  // Fake distance to turn off
-        update_sensor_led(SENSOR_2, 20);
-        update_sensor_led(SENSOR_3, 20);
-        update_sensor_led(SENSOR_4, 20);
-        update_sensor_led(SENSOR_5, 20);
-        update_sensor_led(SENSOR_6, 20);
-        _delay_ms(150);
-    }
     
-    lcd_clear();
+    filter_restore(&saved->filters);
+    for(i = 0; i < NUM_SENSORS; i++) {
+        slot_pulses[i] = saved->pulses[i];
+    }
+    slots_measured = SENSOR_MASK_ALL;
+    boot_showing = 0;  // Straight back to the occupancy display
+    update_fsm_all();
 }
 
-// Update FSM for a Single Slot
-uint8_t update_fsm_slot(SensorID_t sensor_id) {
-    uint16_t distance;
-    ParkingState_t old_state;
-    ParkingState_t new_state;
-    uint8_t state_changed = 0;
-    
-    if(sensor_id >= NUM_SENSORS) return 0;
-    
-    distance = slot_distances[sensor_id];
-    old_state = slot_states[sensor_id];
-    new_state = old_state;
-    
-    if(distance > 0 && distance <= DIST_THRESHOLD_CM) {
-        new_state = STATE_CAR_DETECTED;
-    } else if(distance == 0) {
-        new_state = STATE_ERROR;
-    } else {
-        new_state = STATE_NO_CAR;
-    }
-    
-    if(old_state != new_state) {
-        state_changed = 1;
-        slot_states[sensor_id] = new_state;
-    }
-    
-    return state_changed;
+#if BOOT_PROFILE == BOOT_SHOWCASE
+// Boot Screens
+// The splash screens and LED test as a timed sequence: each step draws a
+// screen or sets the LEDs, then re-arms the task for as long as the step
+// is shown. Measuring goes on meanwhile; at the end the occupancy display
+// takes over the LCD and LEDs.
+static void boot_screen(const char *line1, const char *line2) {
+    lcd_fb_clear();
+    lcd_fb_set_cursor(0, 0);
+    lcd_fb_print(line1);
+    lcd_fb_set_cursor(1, 0);
+    lcd_fb_print(line2);
+    lcd_fb_commit();
 }
 
-// Convert States to Status Array
-void convert_states_to_status(void) {
-    uint8_t i;
+void task_boot_screens(void) {
+    static uint8_t step = 0;
+    uint16_t hold_ms;
     
-    for(i = 0; i < NUM_SENSORS; i++) {
-        slot_status[i] = (slot_states[i] == STATE_CAR_DETECTED) ? 1 : 0;
+    switch(step++) {
+        case 0:
+            boot_screen("SmartPark System", "Initializing...");
+            hold_ms = 1500;
+            break;
+        case 1:
+            boot_screen("By: Noe Setenta", "    Jah Cagula");
+            hold_ms = 1500;
+            break;
+        case 2:
+            boot_screen("Testing LEDs...", "");
+            set_sensor_leds(SENSOR_MASK_ALL);
+            hold_ms = 300;
+            break;
+        case 3:
+        case 5:
+            set_sensor_leds(0);
+            hold_ms = 150;
+            break;
+        case 4:
+            set_sensor_leds(SENSOR_MASK_ALL);
+            hold_ms = 300;
+            break;
+        case 6:
+            boot_screen("System Ready", SENSORS_ACTIVE_TEXT);
+            hold_ms = 1500;
+            break;
+        default:
+            boot_showing = 0;
+            leds_shown = ~slots_occupied;  // Force the LED task to redraw
+            lcd_repaint = 1;
+            return;
     }
+    scheduler_arm(boot_task, hold_ms);
 }
+#endif
 
 // Update FSM for All Slots
+// Classifies every slot from its last pulse width and records which bits
+// flipped, so the display side only works on slots that changed.
 void update_fsm_all(void) {
+    SensorMask_t occupied = 0;
+    SensorMask_t error = 0;
+    SensorMask_t changed;
+#if HEALTH_ENABLED
+    SensorMask_t quarantined = health_quarantined();
+#endif
+    uint16_t pulse;
     uint8_t i;
-    uint8_t any_state_changed = 0;
     
+    PROFILE_ENTER(PROFILE_STAGE_FSM);
     for(i = 0; i < NUM_SENSORS; i++) {
-        if(update_fsm_slot(i)) {
-            any_state_changed = 1;
+        pulse = slot_pulses[i];
+        if(pulse == 0) {
+            error |= SENSOR_MASK(i);
+        } else if(pulse <= DIST_THRESHOLD_TICKS) {
+            occupied |= SENSOR_MASK(i);
         }
     }
     
-    if(any_state_changed) {
-        lcd_needs_update = 1;
-        convert_states_to_status();
+    changed = (occupied ^ slots_occupied) | (error ^ slots_error);
+    slots_occupied = occupied;
+    slots_error = error;
+    lcd_changed |= changed;
+    sampler_activity(changed, (uint16_t)scheduler_millis());
+#if LATENCY_ENABLED
+    latency_shown(changed, occupied, error);
+#endif
+#if HEALTH_ENABLED
+    // A slot going in or out of quarantine keeps its error state but is
+    // drawn and reported differently
+    changed |= quarantined ^ slots_quarantined;
+    lcd_changed |= quarantined ^ slots_quarantined;
+    slots_quarantined = quarantined;
+#endif
+    
+    // Boot metric: the first time every slot has a reading behind it
+    if(!first_occupancy_ms && slots_measured == SENSOR_MASK_ALL) {
+        uint32_t now = scheduler_millis();
+        
+        first_occupancy_ms = (now == 0) ? 1 : (now > 0xFFFF) ? 0xFFFF : (uint16_t)now;
+#if LATENCY_ENABLED
+        latency_discard(SENSOR_MASK_ALL);  // Timed as the boot instead
+#endif
+#if TELEMETRY_ENABLED
+        telemetry_send_boot(occupied, error, first_occupancy_ms, warm_start);
+        changed = 0;  // The boot frame carries the state
+#endif
     }
+    
+#if TELEMETRY_ENABLED
+    if(changed) {
+        telemetry_send_state(occupied, error, slot_pulses);
+    }
+#endif
+    PROFILE_LEAVE(PROFILE_STAGE_FSM);
 }
 
-// Update LEDs based on current state
+// Update LEDs based on current state (only when occupancy changed)
 void update_leds(void) {
-    uint8_t i;
+    PROFILE_ENTER(PROFILE_STAGE_LEDS);
+    if(slots_occupied != leds_shown) {
+        set_sensor_leds(slots_occupied);  // One store per LED port
+        leds_shown = slots_occupied;
+    }
+    PROFILE_LEAVE(PROFILE_STAGE_LEDS);
+}
+
+// Draw one slot's cell(s) into the LCD framebuffer
+static void draw_slot(uint8_t i) {
+    uint8_t occupied = (slots_occupied & SENSOR_MASK(i)) != 0;
+    uint8_t quarantined = (slots_quarantined & SENSOR_MASK(i)) != 0;
     
-    for(i = 0; i < NUM_SENSORS; i++) {
-        update_sensor_led(i, slot_distances[i]);
+#if NUM_SENSORS <= 6
+    // Line 1: P0:0 P1:0 P2:0
+    // Line 2: P3:0 P4:0 P5:0 (X = sensor quarantined)
+    lcd_fb_set_cursor(i / 3, (i % 3) * 5);
+    lcd_fb_putc('P');
+    lcd_fb_putc('0' + i);
+    lcd_fb_putc(':');
+    lcd_fb_putc(quarantined ? 'X' : '0' + occupied);
+#else
+#if NUM_SENSORS > 2 * LCD_COLS - 11
+#error "Too many slots for the occupancy map"
+#endif
+    // Line 2: one cell per slot, '#' = occupied, '.' = free, 'X' = sensor
+    // quarantined; slots past the 16th continue at the right end of line 1
+    if(i < LCD_COLS) {
+        lcd_fb_set_cursor(1, i);
+    } else {
+        lcd_fb_set_cursor(0, 2 * LCD_COLS - NUM_SENSORS + (i - LCD_COLS));
     }
+    lcd_fb_putc(quarantined ? 'X' : occupied ? '#' : '.');
+#endif
 }
 
 // Update LCD Display
+// Redraws only the slots in lcd_changed (or everything after a repaint
+// request or a full/not-full transition); the framebuffer then sends only
+// the cells that actually differ. A slot whose sensor is quarantined is
+// never counted as free.
 void update_lcd_display(void) {
+    static uint8_t showing_full = 0;
+    SensorMask_t taken = slots_occupied | slots_quarantined;
+    uint8_t full = (taken == SENSOR_MASK_ALL);
+    SensorMask_t dirty = lcd_changed;
     uint8_t i;
-    uint8_t occupied_count = 0;
     
-    for(i = 0; i < NUM_SENSORS; i++) {
-        if(slot_status[i] == 1) {
-            occupied_count++;
-        }
+    PROFILE_ENTER(PROFILE_STAGE_LCD);
+    lcd_changed = 0;
+    
+    if(lcd_repaint || full != showing_full) {
+        lcd_repaint = 0;
+        showing_full = full;
+        dirty = SENSOR_MASK_ALL;
+        lcd_fb_clear();
     }
     
-    if(occupied_count == NUM_SENSORS) {
-        lcd_clear();
-        lcd_set_cursor(0, 2);
-        lcd_print("FULL PARKING");
-        lcd_set_cursor(1, 1);
-        lcd_print("NO SPACES");
+    if(full) {
+        lcd_fb_set_cursor(0, 2);
+        lcd_fb_print("FULL PARKING");
+        lcd_fb_set_cursor(1, 1);
+        lcd_fb_print("NO SPACES");
     } else {
-        lcd_clear();
+#if NUM_SENSORS > 6
+        // Line 1: FREE nn/NN
+        uint8_t free_count = NUM_SENSORS - sensor_mask_count(taken);
         
-        // Line 1: P0:0 P1:0 P2:0
-        lcd_set_cursor(0, 0);
-        lcd_print("P0:");
-        lcd_data('0' + slot_status[0]);
-        lcd_print(" P1:");
-        lcd_data('0' + slot_status[1]);
-        lcd_print(" P2:");
-        lcd_data('0' + slot_status[2]);
-        
-        // Line 2: P3:0 P4:0 P5:0
-        lcd_set_cursor(1, 0);
-        lcd_print("P3:");
-        lcd_data('0' + slot_status[3]);
-        lcd_print(" P4:");
-        lcd_data('0' + slot_status[4]);
-        lcd_print(" P5:");
-        lcd_data('0' + slot_status[5]);
+        lcd_fb_set_cursor(0, 0);
+        lcd_fb_print("FREE ");
+        lcd_fb_putc('0' + free_count / 10);
+        lcd_fb_putc('0' + free_count % 10);
+        lcd_fb_print("/" TO_STRING(NUM_SENSORS));
+#endif
+        for(i = 0; dirty; i++, dirty >>= 1) {
+            if(dirty & 0x01) {
+                draw_slot(i);
+            }
+        }
     }
+    
+    lcd_bytes_last_update = lcd_fb_commit();
+    PROFILE_LEAVE(PROFILE_STAGE_LCD);
+}
+
+// Start Measurement Cycle
+// Fires the slots the sampler says are due, with the strategy chosen by
+// MEASURE_STRATEGY; quarantined sensors only fire when a probe is due.
+// The sweep runs from interrupts; sweep_complete() posts task_sweep_done
+// when the last echo lands or the last deadline fires.
+void start_measurement_cycle(void) {
+    uint16_t now = (uint16_t)scheduler_millis();
+    SensorMask_t due = sampler_due(now);
+    
+#if HEALTH_ENABLED
+    due = health_due(due, now);
+#endif
+    
+    // The previous sweep is still running, or done but its readings not
+    // taken yet (firing again would clear them)
+    if(sweep_in_flight) return;
+    
+    PROFILE_ENTER(PROFILE_STAGE_SWEEP);
+    sweep_in_flight = 1;
+    sweep_due = due;
+    sweep_started_ms = now;
+    ultrasonic_sweep_start(due);
 }
 
-// Perform Measurement Cycle
-uint8_t perform_measurement_cycle(void) {
+// Sweep-done callback (interrupt context)
+void sweep_complete(void) {
+    scheduler_post(sweep_done_task);
+}
+
+// Finish Measurement Cycle
+// Runs each new reading through the slot's filter (SLOT_FILTER). Slots
+// not measured keep their last filtered value; quarantined slots read 0.
+uint8_t finish_measurement_cycle(void) {
+    SensorMask_t due = sweep_due;
+    SensorMask_t busy = 0;
+#if HEALTH_ENABLED
+    SensorMask_t silent = ultrasonic_silent_mask();
+#endif
     uint8_t all_valid = 1;
+    uint16_t raw;
+    uint16_t filtered;
     uint8_t i;
-    uint16_t timeout = 0;
-    uint8_t all_done = 0;
     
-    ultrasonic_trigger_all();
+    sweep_duration_us = ultrasonic_last_sweep_us();
+    slots_measured |= due;
     
-    while(!all_done && timeout < 10000) {
-        all_done = 1;
-        for(i = 0; i < NUM_SENSORS; i++) {
-            if(!ultrasonic_is_measurement_done(i)) {
-                all_done = 0;
-                break;
+    for(i = 0; i < NUM_SENSORS; i++) {
+        if(due & SENSOR_MASK(i)) {
+            raw = ultrasonic_get_pulse_ticks(i);
+#if HEALTH_ENABLED
+            if(health_reading(i, raw ? HEALTH_GOOD :
+                              (silent & SENSOR_MASK(i)) ? HEALTH_SILENT : HEALTH_OUT_OF_RANGE,
+                              sweep_started_ms)) {
+                filter_reset(SENSOR_MASK(i));  // Back from quarantine: start from this reading
+            }
+#endif
+            filtered = filter_update(i, raw);
+#if HEALTH_ENABLED
+            if(health_quarantined() & SENSOR_MASK(i)) {
+                filtered = 0;
             }
+#endif
+            slot_pulses[i] = filtered;
+#if LATENCY_ENABLED
+            if(raw == 0) {
+                latency_reading(i, LATENCY_ERROR, ultrasonic_last_sweep_end());
+            } else {
+                latency_reading(i, (raw <= DIST_THRESHOLD_TICKS) ? LATENCY_OCCUPIED : LATENCY_FREE,
+                                ultrasonic_get_echo_time(i));
+            }
+#endif
+            
+            // Keep the slot on the fast rate while its readings are bad,
+            // near the threshold or disagree with the filtered state
+            if(raw == 0 || filtered == 0 ||
+               (raw <= DIST_THRESHOLD_TICKS) != (filtered <= DIST_THRESHOLD_TICKS) ||
+               (raw + DIST_BORDER_TICKS >= DIST_THRESHOLD_TICKS &&
+                raw <= DIST_THRESHOLD_TICKS + DIST_BORDER_TICKS)) {
+                busy |= SENSOR_MASK(i);
+            }
+            
+            ultrasonic_reset_measurement(i);
         }
-        timeout++;
-        _delay_us(1);
-    }
-    
-    for(i = 0; i < NUM_SENSORS; i++) {
-        slot_distances[i] = ultrasonic_get_distance(i);
         
-        if(slot_distances[i] == 0) {
+        if(slot_pulses[i] == 0) {
             all_valid = 0;
         }
-        
-        ultrasonic_reset_measurement(i);
     }
     
+    sampler_measured(due, sweep_started_ms);
+    sampler_activity(busy, sweep_started_ms);
+    sweep_in_flight = 0;
+    PROFILE_LEAVE(PROFILE_STAGE_SWEEP);
     return all_valid;
 }
 
+// Scheduled Tasks
+void task_sense(void) {
+    start_measurement_cycle();
+}
+
+void task_sweep_done(void) {
+    SensorMask_t due = sweep_due;
+    
+    measurements_valid = finish_measurement_cycle();
+    if(due && slots_measured == SENSOR_MASK_ALL) {
+        restart_save(slot_pulses);
+    }
+    restart_kick();  // Sweeps and the main loop are both still going
+    
+    // Publish the first complete picture without waiting for the FSM tick
+    if(!first_occupancy_ms && slots_measured == SENSOR_MASK_ALL) {
+        update_fsm_all();
+    }
+}
+
+void task_fsm(void) {
+    update_fsm_all();
+}
+
+void task_leds(void) {
+    if(boot_showing) return;
+    update_leds();
+}
+
+void task_lcd(void) {
+    if(boot_showing) return;
+    if(lcd_changed || lcd_repaint) {
+        update_lcd_display();
+    }
+}
+
+// Force LCD update every 10 seconds (safety measure)
+void task_lcd_refresh(void) {
+    if(boot_showing) return;
+    lcd_fb_invalidate();  // Repaint every cell in case the LCD glitched
+    lcd_repaint = 1;
+    update_lcd_display();
+}
+
+#if LATENCY_ENABLED
+// Slots whose shown state is fully out: LEDs set, LCD cells sent and the
+// bus idle, telemetry frame sent
+static SensorMask_t outputs_settled(void) {
+    if(boot_showing || lcd_repaint || !twi_is_idle()) return 0;
+#if TELEMETRY_ENABLED
+    if(!usart_is_idle()) return 0;
+#endif
+    return ~(lcd_changed | (leds_shown ^ slots_occupied));
+}
+#endif
+
+#if TELEMETRY_ENABLED
+// Periodic state report so receivers recover from lost frames
+void task_heartbeat(void) {
+    telemetry_send_heartbeat(slots_occupied, slots_error, (uint16_t)(scheduler_millis() / 1000),
+                             scheduler_sleep_permille());
+}
+#endif
+
 // Main Application
 int main(void) {
-    uint8_t measurements_valid;
-    
+    warm_start = restart_init();  // Before anything touches the snapshot
     system_init();
+    if(warm_start) {
+        resume_warm_state();
+    }
+    restart_watchdog_start();
     
-    convert_states_to_status();
-    update_lcd_display();
+    // Tasks due in the same pass run in this order: the finished sweep is
+    // read out before task_sense starts the next one
+    sweep_done_task = scheduler_add_task(task_sweep_done, 0);  // Posted by the sweep
+    scheduler_add_task(task_sense, SENSE_PERIOD_MS);
+    ultrasonic_set_sweep_done(sweep_complete);
+    scheduler_add_task(task_fsm, FSM_PERIOD_MS);
+    scheduler_add_task(task_leds, LED_PERIOD_MS);
+    scheduler_add_task(task_lcd, LCD_PERIOD_MS);
+    scheduler_arm(scheduler_add_task(task_lcd_refresh, LCD_REFRESH_MS), LCD_REFRESH_MS);
+#if TELEMETRY_ENABLED
+    scheduler_add_task(task_heartbeat, TELEMETRY_HEARTBEAT_MS);
+#endif
+#if BOOT_PROFILE == BOOT_SHOWCASE
+    boot_task = scheduler_add_task(task_boot_screens, 0);
+#endif
     
-    while(1) {
-        measurements_valid = perform_measurement_cycle();
-        
-        update_fsm_all();
-        
+    // The first sweep runs from interrupts during the LCD power-up wait
+    start_measurement_cycle();
+    lcd_init();
+    
+#if BOOT_PROFILE == BOOT_SHOWCASE
+    if(!warm_start) {
+        task_boot_screens();
+    }
+#endif
+    if(!boot_showing) {
         update_leds();
-        
-        if(lcd_needs_update) {
-            update_lcd_display();
-            lcd_needs_update = 0;
-        }
-        
-        // Force LCD update every 10 seconds (safety measure)
-        measurement_cycle++;
-        if(measurement_cycle >= 67) { // 67 cycles * 150ms = ~10 seconds
-            measurement_cycle = 0;
-            convert_states_to_status();
-            update_lcd_display();
-        }
-        
-        _delay_ms(UPDATE_INTERVAL_MS);
+        update_lcd_display();
+    }
+    
+    while(1) {
+        scheduler_run();
+#if LATENCY_ENABLED
+        latency_emitted(outputs_settled());
+        latency_poll(slots_occupied, slots_error);
+#endif
+#if PROFILE_ENABLED
+        profile_poll(slots_occupied, slots_error);
+#endif
     }
     
     return 0;
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #include "gpio.h"
 #include "ultrasonic.h"
 #include "lcd.h"
+#include "clock.h"
 #include <avr/interrupt.h>
 #include <util/delay.h>
 
@@ -47,6 +48,9 @@ void system_init(void) {
     // Run LED test sequence
     led_test_sequence();
     
+    // Start the system clock (Timer1): echo timing and sweep deadlines
+    clock_init();
+    
     // Initialize ultrasonic sensors
     ultrasonic_init_all();
     
@@ -258,7 +262,6 @@ void update_lcd_display(void) {
 // Perform Measurement Cycle - SEQUENTIAL (Fixes Crosstalk)
 uint8_t perform_measurement_cycle(void) {
     uint8_t i;
-    uint16_t timeout;
     
     // Reset previous distances before starting
     for(i = 0; i < NUM_SENSORS; i++) {
@@ -268,26 +271,17 @@ uint8_t perform_measurement_cycle(void) {
     // Process sensors ONE BY ONE
     for(i = 0; i < NUM_SENSORS; i++) {
         
-        // 1. Trigger ONLY the current sensor
-        // Note: You might need to check your ultrasonic.h to find the 
-        // function for triggering a single sensor. usually ultrasonic_trigger(i)
-        // If you absolutely MUST use trigger_all, see the note below.
-        ultrasonic_trigger_single(i); 
-        
-        // 2. Wait for this specific sensor to finish
-        timeout = 0;
-        while(!ultrasonic_is_measurement_done(i) && timeout < 3000) { // Approx 25ms timeout
-            _delay_us(10);
-            timeout++;
-        }
+        // 1. Trigger ONLY the current sensor and wait for its echo; the
+        //    Timer1 deadline ends the wait if the echo never comes
+        ultrasonic_sweep_mask(SENSOR_MASK(i));
         
-        // 3. Get distance immediately
+        // 2. Get distance immediately
         slot_distances[i] = ultrasonic_get_distance(i);
         
-        // 4. Reset measurement for next cycle
+        // 3. Reset measurement for next cycle
         ultrasonic_reset_measurement(i);
 
-        // 5. CRITICAL: Small delay between sensors to let echoes die down
+        // 4. CRITICAL: Small delay between sensors to let echoes die down
         _delay_ms(15); 
     }
     
@@ -0,0 +1,130 @@
+#include "profile.h"
+
+#if PROFILE_ENABLED
+#include "clock.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "usart.h"
+
+// Without telemetry nothing is dumped, and the windows are only read
+// through profile_report() (the host sim's bench report)
+#if TELEMETRY_ENABLED
+#define PROFILE_FRAME_LEN  (TELEM_HEADER_LEN + 3 * TELEM_MASK_BYTES(NUM_SENSORS) + \
+                            TELEM_PROFILE_LEN + TELEM_CRC_LEN)
+#endif
+
+// Durations are kept in Timer1 ticks; the count and sum stop at their
+// limits so the mean stays right over the part of the window they cover
+typedef struct {
+    uint32_t entered;
+    uint32_t min;
+    uint32_t max;
+    uint32_t sum;
+    uint16_t count;
+    uint16_t hist[PROFILE_BUCKETS];
+} ProfileStage_t;
+
+static ProfileStage_t stages[PROFILE_STAGES];
+#if TELEMETRY_ENABLED
+static uint8_t dump_pending = 0;    // Stages still to send (bit n = stage n + 1)
+static uint32_t last_dump_ms = 0;
+#endif
+
+static void stage_clear(ProfileStage_t *s) {
+    uint8_t i;
+
+    s->min = UINT32_MAX;
+    s->max = 0;
+    s->sum = 0;
+    s->count = 0;
+    for(i = 0; i < PROFILE_BUCKETS; i++) {
+        s->hist[i] = 0;
+    }
+}
+
+void profile_init(void) {
+    uint8_t i;
+
+    for(i = 0; i < PROFILE_STAGES; i++) {
+        stage_clear(&stages[i]);
+    }
+#if TELEMETRY_ENABLED
+    dump_pending = 0;
+    last_dump_ms = 0;
+#endif
+}
+
+void profile_enter(uint8_t stage) {
+    if(stage == 0 || stage > PROFILE_STAGES) return;
+    stages[stage - 1].entered = clock_now();
+}
+
+void profile_leave(uint8_t stage) {
+    uint32_t now = clock_now();
+    ProfileStage_t *s;
+    uint32_t ticks;
+    uint32_t scaled;
+    uint8_t bucket = 0;
+
+    if(stage == 0 || stage > PROFILE_STAGES) return;
+    s = &stages[stage - 1];
+    ticks = now - s->entered;
+
+    if(ticks < s->min) s->min = ticks;
+    if(ticks > s->max) s->max = ticks;
+    if(s->count < UINT16_MAX && s->sum + ticks >= s->sum) {
+        s->sum += ticks;
+        s->count++;
+    }
+
+    scaled = ticks >> PROFILE_HIST_SHIFT;
+    while(scaled && bucket < PROFILE_BUCKETS - 1) {
+        scaled >>= 1;
+        bucket++;
+    }
+    if(s->hist[bucket] < UINT16_MAX) s->hist[bucket]++;
+}
+
+// Take one stage's window and start a new one
+void profile_report(uint8_t stage, ProfileReport_t *out) {
+    ProfileStage_t *s = &stages[stage - 1];
+    uint8_t i;
+
+    out->count = s->count;
+    out->min_us = s->count ? CLOCK_TICKS_TO_US(s->min) : 0;
+    out->max_us = CLOCK_TICKS_TO_US(s->max);
+    out->mean_us = s->count ? CLOCK_TICKS_TO_US(s->sum / s->count) : 0;
+    for(i = 0; i < PROFILE_BUCKETS; i++) {
+        out->hist[i] = s->hist[i];
+    }
+    stage_clear(s);
+}
+
+// Call from the main loop: sends the next stage of a dump in progress
+// once the USART queue has room for the whole frame, so telemetry frames
+// are never pushed out
+void profile_poll(SensorMask_t occupied, SensorMask_t error) {
+#if TELEMETRY_ENABLED
+    ProfileReport_t report;
+    uint8_t stage;
+
+    if(!dump_pending && scheduler_millis() - last_dump_ms >= PROFILE_DUMP_MS) {
+        last_dump_ms = scheduler_millis();
+        dump_pending = (1 << PROFILE_STAGES) - 1;
+    }
+    if(!dump_pending || usart_queue_free() < PROFILE_FRAME_LEN) return;
+
+    stage = 1;
+    while(!(dump_pending & (1 << (stage - 1)))) {
+        stage++;
+    }
+    dump_pending &= ~(1 << (stage - 1));
+    profile_report(stage, &report);
+    telemetry_send_profile(occupied, error, stage, &report);
+#else
+    (void)occupied;
+    (void)error;
+#endif
+}
+
+#endif // PROFILE_ENABLED
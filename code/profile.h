@@ -0,0 +1,65 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include "slots.h"
+#include "telemetry_proto.h"
+
+// Hot-Path Profiler
+// PROFILE_ENTER/PROFILE_LEAVE mark the main-loop stages below and, when
+// PROFILE_ENABLED is set, time each one on the Timer1 clock. Every stage
+// keeps the count, min, max and mean duration and a log2 histogram of the
+// current window, and the window is sent over the USART as one
+// TELEM_TYPE_PROFILE frame per stage every PROFILE_DUMP_MS, then
+// restarted.
+// Compiled out (the default) the markers cost nothing; compiled in, a
+// stage costs two clock reads and the update.
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED   0
+#endif
+
+#ifndef PROFILE_DUMP_MS
+#define PROFILE_DUMP_MS   10000
+#endif
+
+#if PROFILE_DUMP_MS == 0
+#error "PROFILE_DUMP_MS must be non-zero: dumps are only sent periodically"
+#endif
+
+#define PROFILE_STAGE_SWEEP   1     // Sweep start -> filtered readings ready
+#define PROFILE_STAGE_FSM     2     // update_fsm_all
+#define PROFILE_STAGE_LEDS    3     // update_leds
+#define PROFILE_STAGE_LCD     4     // update_lcd_display (CPU side)
+#define PROFILE_STAGES        4     // PROFILE_STAGE_SWEEP .. PROFILE_STAGE_LCD
+
+// Histogram bucket 0 counts durations under 8 us, bucket k from
+// 2^(k+2) us up to twice that; the last bucket takes everything longer
+#define PROFILE_HIST_SHIFT  4       // Timer1 ticks (0.5 us) -> 8 us
+#define PROFILE_BUCKETS     TELEM_PROFILE_BUCKETS
+
+// One stage's window, as sent (times in microseconds)
+typedef struct {
+    uint16_t count;
+    uint32_t min_us;
+    uint32_t mean_us;
+    uint32_t max_us;
+    uint16_t hist[PROFILE_BUCKETS];
+} ProfileReport_t;
+
+// --- Public Function Prototypes ---
+void profile_init(void);
+void profile_enter(uint8_t stage);
+void profile_leave(uint8_t stage);
+void profile_poll(SensorMask_t occupied, SensorMask_t error);
+void profile_report(uint8_t stage, ProfileReport_t *out);
+
+#if PROFILE_ENABLED
+#define PROFILE_ENTER(stage)  profile_enter(stage)
+#define PROFILE_LEAVE(stage)  profile_leave(stage)
+#else
+#define PROFILE_ENTER(stage)  ((void)0)
+#define PROFILE_LEAVE(stage)  ((void)0)
+#endif
+
+#endif // PROFILE_H
@@ -0,0 +1,112 @@
+#include "restart.h"
+#include <avr/io.h>
+#include <avr/wdt.h>
+#include <stddef.h>
+#include <string.h>
+#include <util/crc16.h>
+
+// Survives resets: the startup code does not clear .noinit
+RestartSnapshot_t restart_snapshot __attribute__((section(".noinit")));
+
+// MCUSR at reset, taken before the C runtime clears .bss
+static uint8_t reset_cause __attribute__((section(".noinit")));
+static uint8_t warm = 0;
+
+#ifdef __AVR__
+#define INIT3_SECTION           __attribute__((naked, used, section(".init3")))
+#define BOOTLOADER_MCUSR(var)   __asm__ __volatile__("mov %0, r2" : "=r"(var))
+#else
+// Host sim: no bootloader, and the sim calls restart_capture_cause() itself
+#define INIT3_SECTION
+#define BOOTLOADER_MCUSR(var)   ((var) = 0)
+#endif
+
+static uint16_t snapshot_crc(void) {
+    const uint8_t *p = (const uint8_t *)&restart_snapshot;
+    uint16_t crc = 0xFFFF;
+    uint16_t i;     // Twelve median-of-5 windows alone are 252 bytes
+
+    for(i = 0; i < offsetof(RestartSnapshot_t, crc); i++) {
+        crc = _crc_ccitt_update(crc, p[i]);
+    }
+    return crc;
+}
+
+// Runs from .init3, ahead of the C runtime. Optiboot clears MCUSR before
+// starting the sketch and leaves the old value in r2, so that copy is
+// taken when MCUSR reads zero. The watchdog stays enabled at its shortest
+// timeout after a watchdog reset, so it is stopped here as well.
+void restart_capture_cause(void) INIT3_SECTION;
+void restart_capture_cause(void) {
+    uint8_t cause = MCUSR;
+
+    if(!cause) {
+        BOOTLOADER_MCUSR(cause);
+    }
+    reset_cause = cause;
+    MCUSR = 0;
+    wdt_disable();
+}
+
+// Call first thing in main(). Decides between a warm and a cold start from
+// the reset cause restart_capture_cause() took. Returns 1 when the
+// snapshot is good and may be resumed.
+uint8_t restart_init(void) {
+    // RAM is not trustworthy after power-on or a brown-out
+    if((reset_cause & ((1 << PORF) | (1 << BORF))) ||
+       !(reset_cause & ((1 << WDRF) | (1 << EXTRF))) ||
+       restart_snapshot.magic != RESTART_MAGIC ||
+       restart_snapshot.size != sizeof(RestartSnapshot_t) ||
+       restart_snapshot.crc != snapshot_crc()) {
+        memset(&restart_snapshot, 0, sizeof(restart_snapshot));
+        restart_snapshot.magic = RESTART_MAGIC;
+        restart_snapshot.size = sizeof(RestartSnapshot_t);
+    }
+
+    // The counters carry over even when no sweep had completed yet
+    warm = restart_snapshot.has_state;
+    if(warm) {
+        restart_snapshot.warm_restarts++;
+    }
+    if(reset_cause & (1 << WDRF)) {
+        restart_snapshot.watchdog_resets++;
+    }
+    restart_snapshot.crc = snapshot_crc();
+    return warm;
+}
+
+void restart_watchdog_start(void) {
+    wdt_enable(RESTART_WDT_TIMEOUT);
+}
+
+void restart_kick(void) {
+    wdt_reset();
+}
+
+// Record the state to resume from (call once every slot has a reading).
+// The checksum goes last, so a reset in the middle of an update leaves a
+// snapshot that is rejected, not a torn one.
+void restart_save(const uint16_t *pulses) {
+    restart_snapshot.crc = ~restart_snapshot.crc;
+    memcpy(restart_snapshot.state.pulses, pulses, sizeof(restart_snapshot.state.pulses));
+    filter_save(&restart_snapshot.state.filters);
+    restart_snapshot.has_state = 1;
+    restart_snapshot.crc = snapshot_crc();
+}
+
+// State saved before the reset, or NULL on a cold start
+const RestartState_t *restart_state(void) {
+    return warm ? &restart_snapshot.state : 0;
+}
+
+uint8_t restart_reset_cause(void) {
+    return reset_cause;
+}
+
+uint16_t restart_warm_count(void) {
+    return restart_snapshot.warm_restarts;
+}
+
+uint16_t restart_watchdog_count(void) {
+    return restart_snapshot.watchdog_resets;
+}
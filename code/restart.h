@@ -0,0 +1,55 @@
+#ifndef RESTART_H
+#define RESTART_H
+
+#include <stdint.h>
+#include "slots.h"
+#include "filter.h"
+
+// Watchdog Supervision and Warm Restart
+// The watchdog is kicked once per completed sweep, so a stuck main loop
+// or a sweep that never finishes resets the board. The state needed to
+// carry on (the filtered pulse widths the slot states are classified
+// from, and the filter windows behind them) is copied after every sweep
+// into a snapshot in .noinit RAM, which the C runtime leaves alone at
+// reset. After a watchdog or external reset a snapshot with a good
+// checksum is restored and the display resumes at once; after power-on
+// or brown-out, or with a bad checksum, the board boots cold.
+
+#ifndef RESTART_WDT_TIMEOUT
+// The longest sweep is sequential over 12 slots with every sensor timing
+// out: 12 x (30 ms timeout + 15 ms guard) = 540 ms, about 525 ms in the
+// host sim. With echoes returning it is far shorter (115-220 ms).
+#define RESTART_WDT_TIMEOUT  WDTO_2S
+#endif
+
+#define RESTART_MAGIC        0x5350    // "SP"
+
+typedef struct {
+    uint16_t pulses[NUM_SENSORS];
+    FilterBank_t filters;
+} RestartState_t;
+
+typedef struct {
+    uint16_t magic;
+    uint16_t size;                 // sizeof(RestartSnapshot_t), catches layout changes
+    uint16_t warm_restarts;        // Resets that resumed from the snapshot
+    uint16_t watchdog_resets;      // Resets caused by the watchdog, warm or not
+    uint8_t has_state;             // state holds a complete picture
+    RestartState_t state;
+    uint16_t crc;                  // CRC-16 of everything above
+} RestartSnapshot_t;
+
+extern RestartSnapshot_t restart_snapshot;
+
+// --- Public Function Prototypes ---
+void restart_capture_cause(void);  // .init3 on the board; the host sim calls it before main
+uint8_t restart_init(void);
+void restart_watchdog_start(void);
+void restart_kick(void);
+void restart_save(const uint16_t *pulses);
+const RestartState_t *restart_state(void);
+uint8_t restart_reset_cause(void);
+uint16_t restart_warm_count(void);
+uint16_t restart_watchdog_count(void);
+
+#endif // RESTART_H
@@ -0,0 +1,87 @@
+#include "sampler.h"
+
+// Times are the low 16 bits of scheduler_millis(), compared by subtraction.
+// That is fine for gaps below 65 s; "quiet long enough" is latched into
+// the settled mask rather than recomputed, so it never wraps.
+static uint16_t measured_at[NUM_SENSORS];
+static uint16_t active_at[NUM_SENSORS];
+static uint16_t max_staleness[NUM_SENSORS];
+static SensorMask_t settled = 0;
+static SensorMask_t seen = 0;         // Measured at least once
+static uint32_t measurements = 0;
+
+void sampler_init(void) {
+    settled = 0;
+    seen = 0;
+    measurements = 0;
+}
+
+// Slots to measure on this sweep. A settled slot is taken on the last
+// sweep that still keeps it within SAMPLE_SLOW_MS.
+SensorMask_t sampler_due(uint16_t now_ms) {
+#if SAMPLE_ADAPTIVE
+    SensorMask_t due = ~settled & SENSOR_MASK_ALL;
+    uint8_t i;
+
+    for(i = 0; i < NUM_SENSORS; i++) {
+        if(!(settled & SENSOR_MASK(i))) {
+            if((uint16_t)(now_ms - active_at[i]) >= SAMPLE_SETTLE_MS) {
+                settled |= SENSOR_MASK(i);   // Takes effect from the next sweep
+            }
+        } else if((uint16_t)(now_ms - measured_at[i]) + SAMPLE_FAST_MS > SAMPLE_SLOW_MS) {
+            due |= SENSOR_MASK(i);
+        }
+    }
+    return due;
+#else
+    (void)now_ms;
+    return SENSOR_MASK_ALL;
+#endif
+}
+
+// Record that the slots were just measured
+void sampler_measured(SensorMask_t slots, uint16_t now_ms) {
+    uint16_t gap;
+    uint8_t i;
+
+    for(i = 0; slots; i++, slots >>= 1) {
+        if(!(slots & 0x01)) continue;
+
+        if(seen & SENSOR_MASK(i)) {
+            gap = now_ms - measured_at[i];
+            if(gap > max_staleness[i]) max_staleness[i] = gap;
+        } else {
+            seen |= SENSOR_MASK(i);
+            active_at[i] = now_ms;
+        }
+        measured_at[i] = now_ms;
+        measurements++;
+    }
+}
+
+// Something is going on at these slots: measure them on every sweep
+void sampler_activity(SensorMask_t slots, uint16_t now_ms) {
+    uint8_t i;
+
+    settled &= ~slots;
+    for(i = 0; slots; i++, slots >>= 1) {
+        if(slots & 0x01) {
+            active_at[i] = now_ms;
+        }
+    }
+}
+
+// Slots currently on the slow rate
+SensorMask_t sampler_settled(void) {
+    return settled;
+}
+
+// Longest gap seen between two measurements of a slot
+uint16_t sampler_max_staleness_ms(uint8_t slot) {
+    if(slot >= NUM_SENSORS) return 0;
+    return max_staleness[slot];
+}
+
+uint32_t sampler_measurement_count(void) {
+    return measurements;
+}
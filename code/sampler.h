@@ -0,0 +1,49 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+#include "slots.h"
+#include "ultrasonic.h"
+
+// Adaptive Sampling
+// Slots that changed recently, read close to the threshold or gave a bad
+// echo are measured on every sweep ("hot"). A slot that has been quiet for
+// SAMPLE_SETTLE_MS drops to one measurement per SAMPLE_SLOW_MS, which is
+// also the longest any slot goes unmeasured. Sweeps skip firing groups
+// with no slot due, so the time saved goes to the hot slots.
+
+#ifndef SAMPLE_ADAPTIVE
+#define SAMPLE_ADAPTIVE  1          // 0 = measure every slot on every sweep
+#endif
+
+#define SAMPLE_FAST_MS   150        // Sweep period (every slot that is hot)
+
+// Maximum staleness of a settled slot. Shorter when a sweep fires more
+// than one group, so the slower sweep still fits the 1 second update
+// requirement (checked in main.c).
+#ifndef SAMPLE_SLOW_MS
+#if MEASURE_STRATEGY == STRATEGY_SIMULTANEOUS
+#define SAMPLE_SLOW_MS   500
+#else
+#define SAMPLE_SLOW_MS   400
+#endif
+#endif
+
+#ifndef SAMPLE_SETTLE_MS
+#define SAMPLE_SETTLE_MS 5000       // Quiet time before a slot slows down
+#endif
+
+#if SAMPLE_SLOW_MS < SAMPLE_FAST_MS || SAMPLE_SETTLE_MS > 60000
+#error "Sampling periods out of range"
+#endif
+
+// --- Public Function Prototypes ---
+void sampler_init(void);
+SensorMask_t sampler_due(uint16_t now_ms);
+void sampler_measured(SensorMask_t slots, uint16_t now_ms);
+void sampler_activity(SensorMask_t slots, uint16_t now_ms);
+SensorMask_t sampler_settled(void);
+uint16_t sampler_max_staleness_ms(uint8_t slot);
+uint32_t sampler_measurement_count(void);
+
+#endif // SAMPLER_H
@@ -0,0 +1,210 @@
+#include "scheduler.h"
+#include "clock.h"
+#include <avr/interrupt.h>
+#include <avr/cpufunc.h>
+#include <avr/sleep.h>
+
+// Task Table Entry
+typedef struct {
+    TaskFunc_t func;
+    uint16_t period_ms;    // 0 = one-shot
+    uint16_t countdown_ms; // Time until next run
+    uint8_t armed;
+    uint16_t run_count;
+    uint32_t wcet_ticks;   // Longest run in system clock ticks (0.5us)
+} Task_t;
+
+// Module-Level Variables
+static Task_t tasks[SCHED_MAX_TASKS];
+static uint8_t task_count = 0;
+static volatile uint8_t pending_ticks = 0;  // Ticks not yet dispatched
+static volatile uint8_t posted = 0;         // Tasks posted by interrupts (bit n = task n)
+static volatile uint32_t millis = 0;
+static uint32_t sleep_ticks = 0;            // Time asleep in this window
+static uint32_t window_start = 0;           // Start of the sleep statistics window (ms)
+static uint16_t sleep_permille = 0;         // Share asleep in the last complete window
+
+// Initialize Timer0 for a 1ms compare-match tick
+// (Timer1 stays free-running for echo timestamps)
+void scheduler_init(void) {
+    TCCR0A = (1 << WGM01);               // CTC mode
+    TCCR0B = (1 << CS01) | (1 << CS00);  // Prescaler = 64 (4us per tick)
+    OCR0A = 249;                         // 250 counts = 1ms
+    TIMSK0 |= (1 << OCIE0A);
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+// Register a task. Periodic tasks are armed to run on the next tick;
+// one-shot tasks (period 0) wait for scheduler_arm().
+uint8_t scheduler_add_task(TaskFunc_t func, uint16_t period_ms) {
+    Task_t *task;
+
+    if(task_count >= SCHED_MAX_TASKS) return SCHED_INVALID;
+
+    task = &tasks[task_count];
+    task->func = func;
+    task->period_ms = period_ms;
+    task->countdown_ms = 1;
+    task->armed = (period_ms != 0);
+    task->run_count = 0;
+    task->wcet_ticks = 0;
+
+    return task_count++;
+}
+
+// (Re)arm a task to run after delay_ms. For periodic tasks this sets the
+// phase of the next run; the period applies again afterwards.
+void scheduler_arm(uint8_t task_id, uint16_t delay_ms) {
+    if(task_id >= task_count) return;
+
+    tasks[task_id].countdown_ms = (delay_ms > 0) ? delay_ms : 1;
+    tasks[task_id].armed = 1;
+}
+
+void scheduler_disarm(uint8_t task_id) {
+    if(task_id >= task_count) return;
+
+    tasks[task_id].armed = 0;
+}
+
+// Run a task on the next pass without waiting for a tick. Safe to call
+// from an interrupt; the task runs once however often it is posted.
+void scheduler_post(uint8_t task_id) {
+    uint8_t sreg = SREG;
+
+    if(task_id >= task_count) return;
+    cli();
+    posted |= (1 << task_id);
+    SREG = sreg;
+}
+
+// Sleep until a tick or an interrupt posts an event. Any interrupt wakes
+// the core (echo edges, sweep deadlines, TWI, USART); the loop goes back
+// to sleep unless there is work. sei right before sleep guarantees the
+// sleep instruction runs first, so a wake-up cannot be missed.
+static void scheduler_idle(void) {
+#if SCHED_SLEEP
+    uint32_t start;
+
+    cli();
+    while(pending_ticks == 0 && posted == 0) {
+        start = clock_now();
+        sleep_enable();
+        sei();
+        sleep_cpu();
+        sleep_disable();
+        cli();
+        sleep_ticks += clock_now() - start;
+    }
+    sei();
+#else
+    while(pending_ticks == 0 && posted == 0) {
+        _NOP();  // Idle between ticks and events
+    }
+#endif
+}
+
+// Wait for the next tick or posted event, then run every task that has
+// come due. Call this from the main loop forever.
+void scheduler_run(void) {
+    uint8_t elapsed;
+    uint8_t due;
+    uint8_t late;
+    uint8_t i;
+    uint32_t start;
+    uint32_t duration;
+    uint32_t now;
+
+    scheduler_idle();
+
+    cli();
+    elapsed = pending_ticks;
+    pending_ticks = 0;
+    due = posted;
+    posted = 0;
+    now = millis;
+    sei();
+
+    if(now - window_start >= SCHED_SLEEP_WINDOW_MS) {
+        sleep_permille = (uint16_t)(sleep_ticks / (CLOCK_MS_TO_TICKS(now - window_start) / 1000));
+        window_start = now;
+        sleep_ticks = 0;
+    }
+
+    // Decide what is due before running anything, so a task armed by
+    // another task during this pass waits for a later tick. A periodic
+    // task's next run counts from when it fell due, not from this pass,
+    // so an overrun elsewhere does not shift its phase; whole periods
+    // missed during the overrun are dropped rather than run back-to-back.
+    for(i = 0; i < task_count; i++) {
+        if(!tasks[i].armed) continue;
+
+        if(tasks[i].countdown_ms <= elapsed) {
+            due |= (1 << i);
+            if(tasks[i].period_ms) {
+                late = elapsed - tasks[i].countdown_ms;
+                tasks[i].countdown_ms = tasks[i].period_ms - (late % tasks[i].period_ms);
+            } else {
+                tasks[i].armed = 0;
+            }
+        } else {
+            tasks[i].countdown_ms -= elapsed;
+        }
+    }
+
+    for(i = 0; i < task_count; i++) {
+        if(!(due & (1 << i))) continue;
+
+        start = clock_now();
+        tasks[i].func();
+        duration = clock_now() - start;
+
+        tasks[i].run_count++;
+        if(duration > tasks[i].wcet_ticks) {
+            tasks[i].wcet_ticks = duration;
+        }
+    }
+}
+
+// Milliseconds since scheduler_init()
+uint32_t scheduler_millis(void) {
+    uint32_t now;
+    uint8_t sreg = SREG;
+
+    cli();
+    now = millis;
+    SREG = sreg;
+    return now;
+}
+
+// Number of tasks added so far
+uint8_t scheduler_task_count(void) {
+    return task_count;
+}
+
+// Number of times a task has run (wraps at 65535)
+uint16_t scheduler_run_count(uint8_t task_id) {
+    if(task_id >= task_count) return 0;
+    return tasks[task_id].run_count;
+}
+
+// Worst-case execution time seen for a task, in microseconds
+uint32_t scheduler_wcet_us(uint8_t task_id) {
+    if(task_id >= task_count) return 0;
+    return CLOCK_TICKS_TO_US(tasks[task_id].wcet_ticks);
+}
+
+// Share of the time spent asleep over the last complete
+// SCHED_SLEEP_WINDOW_MS, in 1/1000 (0 until the first window closes)
+uint16_t scheduler_sleep_permille(void) {
+    return sleep_permille;
+}
+
+// Timer0 Compare Match A Interrupt (1ms tick)
+ISR(TIMER0_COMPA_vect) {
+    millis++;
+    if(pending_ticks < 0xFF) {
+        pending_ticks++;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <avr/io.h>
+#include <stdint.h>
+
+// Maximum number of registered tasks
+#define SCHED_MAX_TASKS  8
+#define SCHED_INVALID    0xFF   // Returned when the task table is full
+
+// Tick length (Timer0 compare match A)
+#define SCHED_TICK_MS    1
+
+// Idle in SLEEP_MODE_IDLE between ticks and events (0 = spin, e.g. while
+// debugging). Power-save is not usable: it stops Timer0 and Timer1.
+#ifndef SCHED_SLEEP
+#define SCHED_SLEEP      1
+#endif
+
+// Window for the sleep statistics; short enough that the time asleep,
+// counted in system clock ticks, cannot wrap
+#define SCHED_SLEEP_WINDOW_MS  10000
+
+typedef void (*TaskFunc_t)(void);
+
+// --- Public Function Prototypes ---
+void scheduler_init(void);
+uint8_t scheduler_add_task(TaskFunc_t func, uint16_t period_ms);
+void scheduler_arm(uint8_t task_id, uint16_t delay_ms);
+void scheduler_disarm(uint8_t task_id);
+void scheduler_post(uint8_t task_id);
+void scheduler_run(void);
+uint32_t scheduler_millis(void);
+
+// Per-task instrumentation (task ids run from 0 in the order added)
+uint8_t scheduler_task_count(void);
+uint16_t scheduler_run_count(uint8_t task_id);
+uint32_t scheduler_wcet_us(uint8_t task_id);
+uint16_t scheduler_sleep_permille(void);
+
+#endif // SCHEDULER_H
@@ -0,0 +1,57 @@
+#include "shiftreg.h"
+#include "gpio.h"
+#include <avr/cpufunc.h>
+#include <avr/interrupt.h>
+
+#if SHIFTREG_ENABLED
+
+static uint32_t shadow = 0;
+
+// Drive all outputs low and make the chain pins outputs
+void shiftreg_init(void) {
+    gpio_dir(SHIFTREG_GPIO_PORT, SHIFTREG_DATA_PIN, GPIO_PIN_OUTPUT);
+    gpio_dir(SHIFTREG_GPIO_PORT, SHIFTREG_CLOCK_PIN, GPIO_PIN_OUTPUT);
+    gpio_dir(SHIFTREG_GPIO_PORT, SHIFTREG_LATCH_PIN, GPIO_PIN_OUTPUT);
+    gpio_set(SHIFTREG_GPIO_PORT, SHIFTREG_CLOCK_PIN, GPIO_PIN_LOW);
+    gpio_set(SHIFTREG_GPIO_PORT, SHIFTREG_LATCH_PIN, GPIO_PIN_LOW);
+    
+    shadow = 0;
+    shiftreg_latch();
+}
+
+// Set the outputs in mask to the matching bits, re-latching the chain
+// only if something changed. Atomic, since the sweep fires triggers on
+// the chain from interrupt context while LEDs are written from the loop.
+void shiftreg_write_bits(uint32_t mask, uint32_t bits) {
+    uint32_t previous;
+    uint8_t sreg = SREG;
+    
+    cli();
+    previous = shadow;
+    shadow = (shadow & ~mask) | (bits & mask);
+    if(shadow != previous) {
+        shiftreg_latch();
+    }
+    SREG = sreg;
+}
+
+// Clock the chain out, last bit first, so bit 0 lands on Q0 of the
+// register nearest the MCU, then pulse RCLK
+void shiftreg_latch(void) {
+    uint8_t i = SHIFTREG_BITS;
+    
+    while(i--) {
+        gpio_set(SHIFTREG_GPIO_PORT, SHIFTREG_DATA_PIN,
+                 (shadow >> i) & 0x01 ? GPIO_PIN_HIGH : GPIO_PIN_LOW);
+        gpio_set(SHIFTREG_GPIO_PORT, SHIFTREG_CLOCK_PIN, GPIO_PIN_HIGH);
+        _NOP();  // SRCLK high time
+        gpio_set(SHIFTREG_GPIO_PORT, SHIFTREG_CLOCK_PIN, GPIO_PIN_LOW);
+        _NOP();  // SRCLK low time
+    }
+    gpio_set(SHIFTREG_GPIO_PORT, SHIFTREG_LATCH_PIN, GPIO_PIN_HIGH);
+    _NOP();
+    gpio_set(SHIFTREG_GPIO_PORT, SHIFTREG_LATCH_PIN, GPIO_PIN_LOW);
+    _NOP();
+}
+
+#endif // SHIFTREG_ENABLED
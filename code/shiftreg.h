@@ -0,0 +1,15 @@
+#ifndef SHIFTREG_H
+#define SHIFTREG_H
+
+#include <stdint.h>
+#include "slots.h"
+
+// 74HC595 output chain for layouts with SHIFTREG_ENABLED (see slots.h).
+// Outputs are kept in a shadow word; shiftreg_latch() clocks the whole
+// chain out and transfers it to the outputs at once.
+
+void shiftreg_init(void);
+void shiftreg_write_bits(uint32_t mask, uint32_t bits);
+void shiftreg_latch(void);
+
+#endif // SHIFTREG_H
@@ -0,0 +1,144 @@
+#ifndef SLOTS_H
+#define SLOTS_H
+
+#include <stdint.h>
+#include "gpio.h"
+
+// Parking Slot Table
+// One SLOT() row per bay:
+//   SLOT(id, trigger port, trigger pin, echo port, echo pin, LED port, LED pin)
+// Sensor IDs, init, triggering, echo dispatch and LED output are all
+// generated from the table, so adding a bay is one row. Echo inputs may be
+// on PORTB, PORTC or PORTD (PCINT0/1/2). Triggers and LEDs may be on a
+// port or on the 74HC595 chain (port SLOT_PORT_SHIFTREG, pin = chain bit).
+// Echoes always need an MCU pin: their edges are timestamped in the ISR.
+
+#define SLOT_PORT_SHIFTREG       3   // Pseudo-port for 74HC595 outputs
+
+// Board Layouts (select with -DSLOT_LAYOUT=...)
+#define SLOT_LAYOUT_6_DIRECT     0   // Original board, everything on MCU pins
+#define SLOT_LAYOUT_12_EXPANDED  1   // 12 bays, triggers and LEDs on 3x 74HC595
+
+#ifndef SLOT_LAYOUT
+#define SLOT_LAYOUT SLOT_LAYOUT_6_DIRECT
+#endif
+
+#if SLOT_LAYOUT == SLOT_LAYOUT_6_DIRECT
+
+#define NUM_SENSORS 6
+#define SLOT_USART_PINS_FREE 0   // LED5/LED6 sit on PD0/PD1 (RXD/TXD)
+
+// Triggers PD2-PD7, echoes PB0-PB5, LEDs PC0-PC3 and PD0-PD1
+#define SLOT_TABLE(SLOT) \
+    SLOT(SENSOR_1, GPIO_PORT_D, 2, GPIO_PORT_B, 0, GPIO_PORT_C, 0) \
+    SLOT(SENSOR_2, GPIO_PORT_D, 3, GPIO_PORT_B, 1, GPIO_PORT_C, 1) \
+    SLOT(SENSOR_3, GPIO_PORT_D, 4, GPIO_PORT_B, 2, GPIO_PORT_C, 2) \
+    SLOT(SENSOR_4, GPIO_PORT_D, 5, GPIO_PORT_B, 3, GPIO_PORT_C, 3) \
+    SLOT(SENSOR_5, GPIO_PORT_D, 6, GPIO_PORT_B, 4, GPIO_PORT_D, 0) \
+    SLOT(SENSOR_6, GPIO_PORT_D, 7, GPIO_PORT_B, 5, GPIO_PORT_D, 1)
+
+// Non-interfering groups for STRATEGY_GROUPED: far-apart pairs
+#define SLOT_FIRING_GROUPS { SENSOR_MASK(SENSOR_1) | SENSOR_MASK(SENSOR_4), \
+                             SENSOR_MASK(SENSOR_2) | SENSOR_MASK(SENSOR_5), \
+                             SENSOR_MASK(SENSOR_3) | SENSOR_MASK(SENSOR_6) }
+#define SLOT_FIRING_GROUP_COUNT 3
+
+#elif SLOT_LAYOUT == SLOT_LAYOUT_12_EXPANDED
+
+#define NUM_SENSORS 12
+#define SLOT_USART_PINS_FREE 1
+
+// RS-485 transceiver driver enable on PD4
+#define USART_DE_PORT        GPIO_PORT_D
+#define USART_DE_PIN         4
+
+// 74HC595 chain on PD5 (SER), PD6 (SRCLK), PD7 (RCLK)
+// Chain bits 0-11 drive the triggers, bits 12-23 the LEDs
+#define SHIFTREG_ENABLED     1
+#define SHIFTREG_GPIO_PORT   GPIO_PORT_D
+#define SHIFTREG_DATA_PIN    5
+#define SHIFTREG_CLOCK_PIN   6
+#define SHIFTREG_LATCH_PIN   7
+#define SHIFTREG_BITS        24
+
+// Echoes PB0-PB5 (PCINT0), PC0-PC3 (PCINT1), PD2-PD3 (PCINT2)
+#define SLOT_TABLE(SLOT) \
+    SLOT(SENSOR_1,  SLOT_PORT_SHIFTREG, 0,  GPIO_PORT_B, 0, SLOT_PORT_SHIFTREG, 12) \
+    SLOT(SENSOR_2,  SLOT_PORT_SHIFTREG, 1,  GPIO_PORT_B, 1, SLOT_PORT_SHIFTREG, 13) \
+    SLOT(SENSOR_3,  SLOT_PORT_SHIFTREG, 2,  GPIO_PORT_B, 2, SLOT_PORT_SHIFTREG, 14) \
+    SLOT(SENSOR_4,  SLOT_PORT_SHIFTREG, 3,  GPIO_PORT_B, 3, SLOT_PORT_SHIFTREG, 15) \
+    SLOT(SENSOR_5,  SLOT_PORT_SHIFTREG, 4,  GPIO_PORT_B, 4, SLOT_PORT_SHIFTREG, 16) \
+    SLOT(SENSOR_6,  SLOT_PORT_SHIFTREG, 5,  GPIO_PORT_B, 5, SLOT_PORT_SHIFTREG, 17) \
+    SLOT(SENSOR_7,  SLOT_PORT_SHIFTREG, 6,  GPIO_PORT_C, 0, SLOT_PORT_SHIFTREG, 18) \
+    SLOT(SENSOR_8,  SLOT_PORT_SHIFTREG, 7,  GPIO_PORT_C, 1, SLOT_PORT_SHIFTREG, 19) \
+    SLOT(SENSOR_9,  SLOT_PORT_SHIFTREG, 8,  GPIO_PORT_C, 2, SLOT_PORT_SHIFTREG, 20) \
+    SLOT(SENSOR_10, SLOT_PORT_SHIFTREG, 9,  GPIO_PORT_C, 3, SLOT_PORT_SHIFTREG, 21) \
+    SLOT(SENSOR_11, SLOT_PORT_SHIFTREG, 10, GPIO_PORT_D, 2, SLOT_PORT_SHIFTREG, 22) \
+    SLOT(SENSOR_12, SLOT_PORT_SHIFTREG, 11, GPIO_PORT_D, 3, SLOT_PORT_SHIFTREG, 23)
+
+// Four groups of three bays, each four bays apart
+#define SLOT_FIRING_GROUPS { \
+    SENSOR_MASK(SENSOR_1) | SENSOR_MASK(SENSOR_5) | SENSOR_MASK(SENSOR_9),  \
+    SENSOR_MASK(SENSOR_2) | SENSOR_MASK(SENSOR_6) | SENSOR_MASK(SENSOR_10), \
+    SENSOR_MASK(SENSOR_3) | SENSOR_MASK(SENSOR_7) | SENSOR_MASK(SENSOR_11), \
+    SENSOR_MASK(SENSOR_4) | SENSOR_MASK(SENSOR_8) | SENSOR_MASK(SENSOR_12) }
+#define SLOT_FIRING_GROUP_COUNT 4
+
+#else
+#error "Unknown SLOT_LAYOUT"
+#endif
+
+#ifndef SHIFTREG_ENABLED
+#define SHIFTREG_ENABLED     0
+#endif
+
+// Sensor IDs, in table order
+#define SLOT_ID(id, tp, tb, ep, eb, lp, lb) id,
+typedef enum {
+    SLOT_TABLE(SLOT_ID)
+    SLOT_ID_COUNT
+} SensorID_t;
+
+// Sensor sets: bit n = sensor n, sized for the layout
+#if NUM_SENSORS <= 8
+typedef uint8_t SensorMask_t;
+#elif NUM_SENSORS <= 16
+typedef uint16_t SensorMask_t;
+#elif NUM_SENSORS <= 24
+typedef uint32_t SensorMask_t;
+#else
+#error "At most 24 slots are supported"
+#endif
+
+#define SENSOR_MASK(id)    ((SensorMask_t)1 << (id))
+#define SENSOR_MASK_ALL    ((SensorMask_t)(((uint32_t)1 << NUM_SENSORS) - 1))
+
+// Number of sensors in a set
+static inline uint8_t sensor_mask_count(SensorMask_t mask) {
+    return (uint8_t)__builtin_popcountl(mask);
+}
+
+// Pins per port for each signal, as compile-time masks
+#define SLOT_PORT_BIT(port, p, b)          (((p) == (port)) ? (1 << (b)) : 0)
+#define SLOT_ECHO_B(id, tp, tb, ep, eb, lp, lb) | SLOT_PORT_BIT(GPIO_PORT_B, ep, eb)
+#define SLOT_ECHO_C(id, tp, tb, ep, eb, lp, lb) | SLOT_PORT_BIT(GPIO_PORT_C, ep, eb)
+#define SLOT_ECHO_D(id, tp, tb, ep, eb, lp, lb) | SLOT_PORT_BIT(GPIO_PORT_D, ep, eb)
+#define ECHO_MASK_PORTB    ((uint8_t)(0 SLOT_TABLE(SLOT_ECHO_B)))
+#define ECHO_MASK_PORTC    ((uint8_t)(0 SLOT_TABLE(SLOT_ECHO_C)))
+#define ECHO_MASK_PORTD    ((uint8_t)(0 SLOT_TABLE(SLOT_ECHO_D)))
+
+#define SLOT_TRIG_B(id, tp, tb, ep, eb, lp, lb) | SLOT_PORT_BIT(GPIO_PORT_B, tp, tb)
+#define SLOT_TRIG_C(id, tp, tb, ep, eb, lp, lb) | SLOT_PORT_BIT(GPIO_PORT_C, tp, tb)
+#define SLOT_TRIG_D(id, tp, tb, ep, eb, lp, lb) | SLOT_PORT_BIT(GPIO_PORT_D, tp, tb)
+#define TRIG_MASK_PORTB    ((uint8_t)(0 SLOT_TABLE(SLOT_TRIG_B)))
+#define TRIG_MASK_PORTC    ((uint8_t)(0 SLOT_TABLE(SLOT_TRIG_C)))
+#define TRIG_MASK_PORTD    ((uint8_t)(0 SLOT_TABLE(SLOT_TRIG_D)))
+
+#define SLOT_LED_B(id, tp, tb, ep, eb, lp, lb)  | SLOT_PORT_BIT(GPIO_PORT_B, lp, lb)
+#define SLOT_LED_C(id, tp, tb, ep, eb, lp, lb)  | SLOT_PORT_BIT(GPIO_PORT_C, lp, lb)
+#define SLOT_LED_D(id, tp, tb, ep, eb, lp, lb)  | SLOT_PORT_BIT(GPIO_PORT_D, lp, lb)
+#define LED_MASK_PORTB     ((uint8_t)(0 SLOT_TABLE(SLOT_LED_B)))
+#define LED_MASK_PORTC     ((uint8_t)(0 SLOT_TABLE(SLOT_LED_C)))
+#define LED_MASK_PORTD     ((uint8_t)(0 SLOT_TABLE(SLOT_LED_D)))
+
+#endif // SLOTS_H
@@ -0,0 +1,159 @@
+#include "telemetry.h"
+#include "usart.h"
+#include "health.h"
+
+#if TELEMETRY_ENABLED
+
+#define MASK_BYTES TELEM_MASK_BYTES(NUM_SENSORS)
+
+// No payload may outgrow the pulse widths TELEM_MAX_FRAME makes room for
+_Static_assert(4 <= 2 * TELEM_MAX_SLOTS, "heartbeat payload outgrows TELEM_MAX_FRAME");
+_Static_assert(TELEM_PROFILE_LEN <= 2 * TELEM_MAX_SLOTS, "profile payload outgrows TELEM_MAX_FRAME");
+_Static_assert(TELEM_LATENCY_LEN <= 2 * TELEM_MAX_SLOTS, "latency payload outgrows TELEM_MAX_FRAME");
+
+// A whole frame is queued at once, so the largest one must fit the queue
+_Static_assert(USART_QUEUE_SIZE >= TELEM_MAX_FRAME, "USART_QUEUE_SIZE below TELEM_MAX_FRAME");
+
+static uint8_t frame[TELEM_MAX_FRAME];
+static uint8_t sequence = 0;
+
+void telemetry_init(void) {
+    usart_init(TELEMETRY_BAUD);
+}
+
+// Write the fixed header and the masks, with the quarantine mask only
+// while a sensor is quarantined; returns the payload write index
+static uint8_t begin_frame(uint8_t type, SensorMask_t occupied, SensorMask_t error) {
+#if HEALTH_ENABLED
+    SensorMask_t quarantined = health_quarantined();
+#endif
+    uint8_t pos = TELEM_HEADER_LEN;
+    uint8_t i;
+
+    frame[0] = TELEM_SYNC;
+    frame[2] = type;
+    frame[3] = TELEMETRY_NODE_ID;
+    frame[4] = sequence++;   // Counted even if dropped, so the receiver sees the gap
+    frame[5] = NUM_SENSORS;
+
+    for(i = 0; i < MASK_BYTES; i++) {
+        frame[pos++] = (uint8_t)(occupied >> (8 * i));
+    }
+    for(i = 0; i < MASK_BYTES; i++) {
+        frame[pos++] = (uint8_t)(error >> (8 * i));
+    }
+#if HEALTH_ENABLED
+    if(quarantined) {
+        frame[2] |= TELEM_FLAG_QUARANTINE;
+        for(i = 0; i < MASK_BYTES; i++) {
+            frame[pos++] = (uint8_t)(quarantined >> (8 * i));
+        }
+    }
+#endif
+    return pos;
+}
+
+// Little-endian field of len bytes; returns the next write index
+static uint8_t put_le(uint8_t pos, uint32_t value, uint8_t len) {
+    while(len--) {
+        frame[pos++] = (uint8_t)value;
+        value >>= 8;
+    }
+    return pos;
+}
+
+// Fill in the length, append the CRC and queue the frame
+static uint8_t finish_frame(uint8_t end) {
+    uint16_t crc = TELEM_CRC_INIT;
+    uint8_t i;
+
+    frame[1] = end - 2;
+    for(i = 1; i < end; i++) {
+        crc = telem_crc_update(crc, frame[i]);
+    }
+    frame[end++] = (uint8_t)crc;
+    frame[end++] = (uint8_t)(crc >> 8);
+
+    return usart_write(frame, end);
+}
+
+// Report a state change. Returns 0 if the frame had to be dropped.
+uint8_t telemetry_send_state(SensorMask_t occupied, SensorMask_t error, const uint16_t *pulses) {
+    uint8_t type = TELEM_TYPE_STATE;
+    uint8_t pos;
+    uint8_t i;
+
+    if(TELEMETRY_SEND_PULSES && pulses) {
+        type |= TELEM_FLAG_PULSES;
+    }
+    pos = begin_frame(type, occupied, error);
+
+    if(type & TELEM_FLAG_PULSES) {
+        for(i = 0; i < NUM_SENSORS; i++) {
+            frame[pos++] = (uint8_t)pulses[i];
+            frame[pos++] = (uint8_t)(pulses[i] >> 8);
+        }
+    }
+    return finish_frame(pos);
+}
+
+// Periodic keep-alive carrying the full state, so a receiver that missed
+// a change (or just joined the line) catches up. Also carries how much of
+// the time the MCU slept (scheduler_sleep_permille).
+uint8_t telemetry_send_heartbeat(SensorMask_t occupied, SensorMask_t error, uint16_t uptime_s,
+                                 uint16_t sleep_permille) {
+    uint8_t pos = begin_frame(TELEM_TYPE_HEARTBEAT, occupied, error);
+
+    frame[pos++] = (uint8_t)uptime_s;
+    frame[pos++] = (uint8_t)(uptime_s >> 8);
+    frame[pos++] = (uint8_t)sleep_permille;
+    frame[pos++] = (uint8_t)(sleep_permille >> 8);
+    return finish_frame(pos);
+}
+
+// First state after reset, with the time it took to get there, so the
+// receiver sees both the restart and how long the bay was dark. A warm
+// restart resumed the state from before the reset (restart.h).
+uint8_t telemetry_send_boot(SensorMask_t occupied, SensorMask_t error, uint16_t first_ms,
+                            uint8_t warm) {
+    uint8_t pos = begin_frame(TELEM_TYPE_BOOT | (warm ? TELEM_FLAG_WARM : 0), occupied, error);
+
+    frame[pos++] = (uint8_t)first_ms;
+    frame[pos++] = (uint8_t)(first_ms >> 8);
+    return finish_frame(pos);
+}
+
+// One stage's profiler window (profile.h)
+uint8_t telemetry_send_profile(SensorMask_t occupied, SensorMask_t error, uint8_t stage,
+                               const ProfileReport_t *report) {
+    uint8_t pos = begin_frame(TELEM_TYPE_PROFILE, occupied, error);
+    uint8_t i;
+
+    frame[pos++] = stage;
+    pos = put_le(pos, report->count, 2);
+    pos = put_le(pos, report->min_us, 4);
+    pos = put_le(pos, report->mean_us, 4);
+    pos = put_le(pos, report->max_us, 4);
+    for(i = 0; i < PROFILE_BUCKETS; i++) {
+        pos = put_le(pos, report->hist[i], 2);
+    }
+    return finish_frame(pos);
+}
+
+// One slot's detection latency histogram (latency.h)
+uint8_t telemetry_send_latency(SensorMask_t occupied, SensorMask_t error, uint8_t slot,
+                               const SlotLatency_t *latency) {
+    uint8_t pos = begin_frame(TELEM_TYPE_LATENCY, occupied, error);
+    uint8_t i;
+
+    frame[pos++] = slot;
+    pos = put_le(pos, latency->count, 2);
+    pos = put_le(pos, latency->last_ms, 2);
+    pos = put_le(pos, latency->max_ms, 2);
+    for(i = 0; i < LATENCY_BUCKETS; i++) {
+        frame[pos++] = latency->hist[i];
+    }
+    return finish_frame(pos);
+}
+
+#endif // TELEMETRY_ENABLED
@@ -0,0 +1,49 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "slots.h"
+#include "telemetry_proto.h"
+#include "profile.h"
+#include "latency.h"
+
+// Occupancy telemetry over the USART (frame format in telemetry_proto.h).
+// Needs PD0/PD1, so it defaults to on only for layouts that leave them free.
+
+#ifndef TELEMETRY_ENABLED
+#define TELEMETRY_ENABLED      SLOT_USART_PINS_FREE
+#endif
+
+#if TELEMETRY_ENABLED && !SLOT_USART_PINS_FREE
+#error "Telemetry needs PD0/PD1 (USART), which this slot layout uses"
+#endif
+
+#ifndef TELEMETRY_NODE_ID
+#define TELEMETRY_NODE_ID      1      // Unique per controller on a shared line
+#endif
+
+#ifndef TELEMETRY_BAUD
+#define TELEMETRY_BAUD         115200UL
+#endif
+
+#ifndef TELEMETRY_HEARTBEAT_MS
+#define TELEMETRY_HEARTBEAT_MS 5000
+#endif
+
+#ifndef TELEMETRY_SEND_PULSES
+#define TELEMETRY_SEND_PULSES  0      // 1 = append raw echo widths to state frames
+#endif
+
+// --- Public Function Prototypes ---
+void telemetry_init(void);
+uint8_t telemetry_send_state(SensorMask_t occupied, SensorMask_t error, const uint16_t *pulses);
+uint8_t telemetry_send_heartbeat(SensorMask_t occupied, SensorMask_t error, uint16_t uptime_s,
+                                 uint16_t sleep_permille);
+uint8_t telemetry_send_boot(SensorMask_t occupied, SensorMask_t error, uint16_t first_ms,
+                            uint8_t warm);
+uint8_t telemetry_send_profile(SensorMask_t occupied, SensorMask_t error, uint8_t stage,
+                               const ProfileReport_t *report);
+uint8_t telemetry_send_latency(SensorMask_t occupied, SensorMask_t error, uint8_t slot,
+                               const SlotLatency_t *latency);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,68 @@
+#ifndef TELEMETRY_PROTO_H
+#define TELEMETRY_PROTO_H
+
+#include <stdint.h>
+
+// Telemetry Frame Format (shared by the firmware and host tools)
+//
+//   [0]  TELEM_SYNC
+//   [1]  length: bytes from [2] up to the end of the payload
+//   [2]  type (low nibble) | flags
+//   [3]  node id
+//   [4]  sequence number (+1 per frame, wraps)
+//   [5]  slot count n
+//   [6]  occupied mask, TELEM_MASK_BYTES(n) bytes, little endian
+//        error mask, same size
+//        TELEM_FLAG_QUARANTINE only: quarantined sensors mask, same size
+//        heartbeat only: uptime in seconds, 2 bytes LE (wraps), then the
+//        share of time the MCU slept in 1/1000, 2 bytes LE
+//        boot only: ms from reset to the first complete reading, 2 bytes LE
+//        profile only: stage (PROFILE_STAGE_*), count 2 bytes, min, mean and
+//        max in us 4 bytes each, then TELEM_PROFILE_BUCKETS histogram
+//        counts 2 bytes each, all LE (see profile.h)
+//        latency only: slot, count 2 bytes, last and max ms 2 bytes each,
+//        all LE, then TELEM_LATENCY_BUCKETS histogram counts 1 byte each
+//        (see latency.h)
+//        TELEM_FLAG_PULSES only: n echo widths in Timer1 ticks, 2 bytes LE
+//   CRC-16 (CCITT, reflected, init 0xFFFF) over [1] .. end of payload, LE
+//
+// A six-slot state change is 10 bytes (under 1 ms at 115200 baud).
+
+#define TELEM_SYNC             0xA5
+
+#define TELEM_TYPE_STATE       0x01   // Sent on every occupancy/error change
+#define TELEM_TYPE_HEARTBEAT   0x02   // Sent periodically, same state plus uptime and sleep
+#define TELEM_TYPE_BOOT        0x03   // Sent once after reset, first state plus boot time
+#define TELEM_TYPE_PROFILE     0x04   // Stage timings, one frame per stage (PROFILE_ENABLED)
+#define TELEM_TYPE_LATENCY     0x05   // One slot's detection latency histogram
+#define TELEM_TYPE_MASK        0x0F
+#define TELEM_FLAG_PULSES      0x80   // Raw pulse widths appended
+#define TELEM_FLAG_WARM        0x40   // Boot frames: state resumed from before the reset
+#define TELEM_FLAG_QUARANTINE  0x20   // Quarantine mask follows the error mask (health.h)
+
+#define TELEM_HEADER_LEN       6
+#define TELEM_CRC_LEN          2
+#define TELEM_MAX_SLOTS        24
+#define TELEM_MASK_BYTES(n)    (((n) + 7) / 8)
+#define TELEM_PROFILE_BUCKETS  16
+#define TELEM_PROFILE_LEN      (1 + 2 + 3 * 4 + 2 * TELEM_PROFILE_BUCKETS)
+#define TELEM_LATENCY_BUCKETS  9      // 125 ms wide, the last one from 1 s up
+#define TELEM_LATENCY_LEN      (1 + 3 * 2 + TELEM_LATENCY_BUCKETS)
+
+// Largest frame: a state frame with a quarantine mask and pulse widths,
+// 65 bytes at TELEM_MAX_SLOTS. The heartbeat, boot, profile and latency
+// payloads all fit in the room of the pulse widths (checked in telemetry.c).
+#define TELEM_MAX_FRAME        (TELEM_HEADER_LEN + 3 * TELEM_MASK_BYTES(TELEM_MAX_SLOTS) + \
+                                2 * TELEM_MAX_SLOTS + TELEM_CRC_LEN)
+
+#define TELEM_CRC_INIT         0xFFFF
+
+// Same result as avr-libc's _crc_ccitt_update()
+static inline uint16_t telem_crc_update(uint16_t crc, uint8_t data) {
+    data ^= (uint8_t)crc;
+    data ^= (uint8_t)(data << 4);
+    return (uint16_t)((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^
+                      ((uint16_t)data << 3));
+}
+
+#endif // TELEMETRY_PROTO_H
@@ -0,0 +1,186 @@
+#include "twi.h"
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+#define TWI_QUEUE_MASK (TWI_QUEUE_SIZE - 1)
+
+// TWCR values used by the transmit engine
+#define TWCR_START     ((1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE))
+#define TWCR_SEND      ((1 << TWINT) | (1 << TWEN) | (1 << TWIE))
+#define TWCR_STOP      ((1 << TWINT) | (1 << TWEN) | (1 << TWSTO))
+#define TWCR_RESTART   ((1 << TWINT) | (1 << TWEN) | (1 << TWIE) | (1 << TWSTO) | (1 << TWSTA))
+
+// Ring buffer of pending bytes. Head/tail run freely and are masked on
+// access, so (head - tail) is the queue depth without wasting a slot.
+static volatile uint8_t queue_data[TWI_QUEUE_SIZE];
+static volatile uint8_t queue_end[TWI_QUEUE_SIZE / 8];  // One TWI_END bit per slot
+static volatile uint8_t queue_head = 0;                 // Written by producer only
+static volatile uint8_t queue_tail = 0;                 // Written by ISR only
+
+static volatile uint8_t bus_busy = 0;          // Transaction in progress
+static volatile uint8_t end_after_current = 0; // Byte on the wire carries TWI_END
+static volatile uint8_t high_water = 0;        // Deepest queue seen
+static volatile uint16_t errors = 0;           // NACKs and lost arbitrations
+static uint8_t slave_address = 0;
+
+// Load the next queued byte into the data register
+static void twi_send_next(void) {
+    uint8_t idx = queue_tail & TWI_QUEUE_MASK;
+
+    TWDR = queue_data[idx];
+    end_after_current = queue_end[idx >> 3] & (1 << (idx & 7));
+    queue_tail++;
+    TWCR = TWCR_SEND;
+}
+
+// Release the bus, or restart straight away if more bytes are waiting
+static void twi_release_bus(void) {
+    if(queue_head != queue_tail) {
+        TWCR = TWCR_RESTART;  // STOP followed by a new START
+    } else {
+        TWCR = TWCR_STOP;     // Interrupt disabled until the next kick
+        bus_busy = 0;
+    }
+}
+
+// Advance the transmit state machine by one bus event
+static void twi_service(void) {
+    switch(TW_STATUS) {
+        case TW_START:
+        case TW_REP_START:
+            end_after_current = 0;
+            TWDR = slave_address << 1;  // SLA+W
+            TWCR = TWCR_SEND;
+            break;
+
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            if(!end_after_current && queue_head != queue_tail) {
+                twi_send_next();
+            } else {
+                twi_release_bus();
+            }
+            break;
+
+        case TW_MT_SLA_NACK:
+            // Nobody answered: drop one byte so a missing device
+            // cannot stall the queue forever
+            if(queue_head != queue_tail) {
+                queue_tail++;
+            }
+            errors++;
+            twi_release_bus();
+            break;
+
+        default:
+            // Data NACK or arbitration lost: the byte in flight is gone
+            errors++;
+            twi_release_bus();
+            break;
+    }
+}
+
+// Make progress while waiting. With global interrupts disabled (e.g. during
+// system_init before sei()) the engine is driven by polling TWINT instead.
+static void twi_poll(void) {
+    if(!(SREG & (1 << SREG_I)) && (TWCR & (1 << TWINT))) {
+        twi_service();
+    }
+}
+
+// Initialize the TWI peripheral at 100kHz for the given 7-bit slave address
+void twi_init(uint8_t address) {
+    slave_address = address;
+    TWSR = 0x00;
+    TWBR = 0x48;  // F_SCL = F_CPU / (16 + 2*TWBR) = 100kHz @ 16MHz
+    TWCR = (1 << TWEN);
+}
+
+// Queue one byte for transmission; blocks only while the queue is full
+void twi_enqueue(uint8_t data, uint8_t flags) {
+    uint8_t idx;
+    uint8_t depth;
+    uint8_t sreg;
+
+    while((uint8_t)(queue_head - queue_tail) >= TWI_QUEUE_SIZE) {
+        twi_poll();
+    }
+
+    idx = queue_head & TWI_QUEUE_MASK;
+    queue_data[idx] = data;
+    if(flags & TWI_END) {
+        queue_end[idx >> 3] |= (1 << (idx & 7));
+    } else {
+        queue_end[idx >> 3] &= ~(1 << (idx & 7));
+    }
+
+    sreg = SREG;
+    cli();
+    queue_head++;
+    depth = queue_head - queue_tail;
+    if(depth > high_water) {
+        high_water = depth;
+    }
+    if(!bus_busy) {
+        bus_busy = 1;
+        while(TWCR & (1 << TWSTO));  // Previous STOP still on the wire
+        TWCR = TWCR_START;
+    }
+    SREG = sreg;
+}
+
+// Mark the most recently queued byte as the end of its transaction
+void twi_mark_end(void) {
+    uint8_t idx;
+    uint8_t sreg = SREG;
+
+    cli();
+    if(queue_head != queue_tail) {
+        idx = (queue_head - 1) & TWI_QUEUE_MASK;
+        queue_end[idx >> 3] |= (1 << (idx & 7));
+    } else if(bus_busy) {
+        end_after_current = 1;  // It is already on the wire
+    }
+    SREG = sreg;
+}
+
+// Wait until every queued byte has been sent and the bus is released
+void twi_flush(void) {
+    while(!twi_is_idle()) {
+        twi_poll();
+    }
+}
+
+// Check if the queue is empty and no transaction is in progress
+uint8_t twi_is_idle(void) {
+    return (queue_head == queue_tail) && !bus_busy;
+}
+
+// Number of bytes waiting to be sent
+uint8_t twi_queue_depth(void) {
+    return queue_head - queue_tail;
+}
+
+// Deepest the queue has been since the last reset
+uint8_t twi_queue_high_water(void) {
+    return high_water;
+}
+
+void twi_reset_high_water(void) {
+    high_water = twi_queue_depth();
+}
+
+uint16_t twi_error_count(void) {
+    uint16_t count;
+    uint8_t sreg = SREG;
+
+    cli();
+    count = errors;
+    SREG = sreg;
+    return count;
+}
+
+// TWI Interrupt Service Routine (one call per bus event)
+ISR(TWI_vect) {
+    twi_service();
+}
@@ -0,0 +1,28 @@
+#ifndef TWI_H
+#define TWI_H
+
+#include <avr/io.h>
+#include <stdint.h>
+
+// Transmit queue size in bytes (must be a power of two, max 128)
+#define TWI_QUEUE_SIZE 128
+
+// Flags for twi_enqueue()
+#define TWI_CONTINUE  0x00   // Keep the transaction open after this byte
+#define TWI_END       0x01   // Send STOP after this byte
+
+// A transaction also ends whenever the queue runs dry, so bytes queued
+// back-to-back with TWI_CONTINUE share a single START/address header.
+
+// --- Public Function Prototypes ---
+void twi_init(uint8_t address);
+void twi_enqueue(uint8_t data, uint8_t flags);
+void twi_mark_end(void);
+void twi_flush(void);
+uint8_t twi_is_idle(void);
+uint8_t twi_queue_depth(void);
+uint8_t twi_queue_high_water(void);
+void twi_reset_high_water(void);
+uint16_t twi_error_count(void);
+
+#endif // TWI_H
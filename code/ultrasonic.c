@@ -1,74 +1,191 @@
 #include "ultrasonic.h"
 #include "gpio.h"
+#include "clock.h"
+#include "shiftreg.h"
 #include <avr/interrupt.h>
+#include <avr/cpufunc.h>
 #include <util/delay.h>
 
 // Module-Level Variables
-volatile uint16_t pulse_start[NUM_SENSORS] = {0};
-volatile uint16_t pulse_end[NUM_SENSORS] = {0};
+volatile uint32_t pulse_start[NUM_SENSORS] = {0};
+volatile uint32_t pulse_end[NUM_SENSORS] = {0};
 volatile uint8_t measurement_active[NUM_SENSORS] = {0};
 volatile uint8_t measurement_done[NUM_SENSORS] = {0};
-volatile uint8_t last_portb_state = 0;
+volatile uint8_t last_echo_state[3] = {0};   // Last PINB/PINC/PIND seen by the ISRs
+static volatile uint32_t last_sweep_us = 0;
+static volatile uint32_t last_sweep_end = 0;   // Clock time the last sweep ended
+
+// Sweep State Machine
+// A sweep runs entirely from interrupts: the echo ISRs retire sensors as
+// their echoes end, and Timer1 compare match A enforces the echo deadline
+// of each group and the guard time before the next one. The sweep ends the
+// moment the last echo lands or the last deadline fires.
+typedef enum {
+    SWEEP_IDLE,
+    SWEEP_ECHO,     // Group fired, waiting for echoes or the deadline
+    SWEEP_GUARD     // Group finished, waiting out FIRING_GUARD_MS
+} SweepPhase_t;
+
+static volatile uint8_t sweep_phase = SWEEP_IDLE;
+static volatile SensorMask_t sweep_mask = 0;       // Sensors in this sweep
+static volatile SensorMask_t sweep_waiting = 0;    // Fired, no echo yet
+static volatile SensorMask_t sweep_timed_out = 0;  // Missed their deadline
+static volatile SensorMask_t sweep_silent = 0;     // Timed out without an echo edge
+static volatile uint8_t sweep_group = 0;           // Next group to look at
+static uint32_t sweep_start = 0;
+static SweepDoneFunc_t sweep_done_func = 0;
+
+_Static_assert(SLOT_ID_COUNT == NUM_SENSORS, "NUM_SENSORS does not match SLOT_TABLE");
+
+// Pin Table generated from SLOT_TABLE
+typedef struct {
+    uint8_t trig_port;
+    uint8_t trig_pin;
+    uint8_t echo_port;
+    uint8_t echo_pin;
+    uint8_t led_port;
+    uint8_t led_pin;
+} SlotPins_t;
+
+#define SLOT_PINS(id, tp, tb, ep, eb, lp, lb) [id] = { tp, tb, ep, eb, lp, lb },
+static const SlotPins_t slot_pins[NUM_SENSORS] = { SLOT_TABLE(SLOT_PINS) };
+
+// Firing Group Table for the selected strategy
+#if MEASURE_STRATEGY == STRATEGY_SIMULTANEOUS
+static const SensorMask_t firing_groups[] = { SENSOR_MASK_ALL };
+#elif MEASURE_STRATEGY == STRATEGY_SEQUENTIAL
+#define SLOT_ALONE(id, tp, tb, ep, eb, lp, lb) SENSOR_MASK(id),
+static const SensorMask_t firing_groups[] = { SLOT_TABLE(SLOT_ALONE) };
+#else
+static const SensorMask_t firing_groups[] = FIRING_GROUPS;
+#endif
+#define NUM_FIRING_GROUPS (sizeof(firing_groups) / sizeof(firing_groups[0]))
+
+// SWEEP_WORST_MS (the latency guard in main.c) counts on this
+_Static_assert(NUM_FIRING_GROUPS == SWEEP_GROUPS, "FIRING_GROUP_COUNT mismatch");
+
+#define PULSE_TIMEOUT_TICKS CLOCK_US_TO_TICKS(PULSE_TIMEOUT_US)
+#define FIRING_GUARD_TICKS  CLOCK_MS_TO_TICKS(FIRING_GUARD_MS)
+
+// Deadlines are a single OCR1A compare, so they must fit one Timer1 period
+_Static_assert(PULSE_TIMEOUT_TICKS < 0x10000, "PULSE_TIMEOUT_US longer than one Timer1 period");
+_Static_assert(FIRING_GUARD_TICKS < 0x10000, "FIRING_GUARD_MS longer than one Timer1 period");
+
+// One block per echo pin on a PCINT bank, generated from the slot table.
+// With the sensor and bit known at compile time every access is a direct
+// lds/sts; slots on other banks fold away.
+#define SLOT_ECHO_EDGE(id, tp, tb, ep, eb, lp, lb) \
+    if((ep) == bank && (changed_bits & (1 << (eb)))) { \
+        if(current_state & (1 << (eb))) { \
+            pulse_start[id] = now; \
+            measurement_active[id] = 1; \
+        } else if(measurement_active[id]) { \
+            pulse_end[id] = now; \
+            measurement_done[id] = 1; \
+            measurement_active[id] = 0; \
+            sweep_waiting &= ~SENSOR_MASK(id); \
+        } \
+    }
 
 // Helper Functions
-static uint8_t get_trigger_pin(SensorID_t sensor_id) {
-    switch(sensor_id) {
-        case SENSOR_1: return TRIGGER_1_PIN;
-        case SENSOR_2: return TRIGGER_2_PIN;
-        case SENSOR_3: return TRIGGER_3_PIN;
-        case SENSOR_4: return TRIGGER_4_PIN;
-        case SENSOR_5: return TRIGGER_5_PIN;
-        case SENSOR_6: return TRIGGER_6_PIN;
-        default: return TRIGGER_1_PIN;
+
+// Drive a trigger or LED output, wherever the table put it
+static void slot_output(uint8_t port, uint8_t pin, uint8_t on) {
+#if SHIFTREG_ENABLED
+    if(port == SLOT_PORT_SHIFTREG) {
+        shiftreg_write_bits((uint32_t)1 << pin, on ? (uint32_t)1 << pin : 0);
+        return;
     }
+#endif
+    gpio_write(port, pin, on ? GPIO_PIN_HIGH : GPIO_PIN_LOW);
+}
+
+// Pins of a set of sensors, gathered per port (and chain) so each port is
+// written once
+typedef struct {
+    uint8_t port[3];
+    uint32_t chain;
+} SlotBits_t;
+
+static void collect_pins(SensorMask_t sensor_mask, uint8_t use_led, SlotBits_t *bits) {
+    uint8_t port;
+    uint8_t pin;
+    uint8_t i;
+    
+    bits->port[GPIO_PORT_B] = 0;
+    bits->port[GPIO_PORT_C] = 0;
+    bits->port[GPIO_PORT_D] = 0;
+    bits->chain = 0;
+    
+    for(i = 0; i < NUM_SENSORS; i++) {
+        if(!(sensor_mask & SENSOR_MASK(i))) continue;
+        port = use_led ? slot_pins[i].led_port : slot_pins[i].trig_port;
+        pin = use_led ? slot_pins[i].led_pin : slot_pins[i].trig_pin;
+        if(port == SLOT_PORT_SHIFTREG) {
+            bits->chain |= (uint32_t)1 << pin;
+        } else {
+            bits->port[port] |= (1 << pin);
+        }
+    }
+}
+
+// Set or clear the triggers of every sensor in a mask: all triggers on a
+// port switch in the same store (and the chain in one latch), so sensors
+// fired together start together
+static void write_triggers(SensorMask_t sensor_mask, GpioValue_t value) {
+    SlotBits_t bits;
+    
+    collect_pins(sensor_mask, 0, &bits);
+    
+    if(TRIG_MASK_PORTB) gpio_write_mask(GPIO_PORT_B, bits.port[GPIO_PORT_B], value);
+    if(TRIG_MASK_PORTC) gpio_write_mask(GPIO_PORT_C, bits.port[GPIO_PORT_C], value);
+    if(TRIG_MASK_PORTD) gpio_write_mask(GPIO_PORT_D, bits.port[GPIO_PORT_D], value);
+#if SHIFTREG_ENABLED
+    shiftreg_write_bits(bits.chain, value ? bits.chain : 0);
+#endif
 }
 
 // Initialize All Ultrasonic Sensors
 void ultrasonic_init_all(void) {
+    const SlotPins_t *pins;
     uint8_t i;
     
-    // Initialize all trigger pins as outputs (LOW)
+#if SHIFTREG_ENABLED
+    shiftreg_init();
+#endif
+    
     for(i = 0; i < NUM_SENSORS; i++) {
-        uint8_t pin = get_trigger_pin(i);
-        gpio_set_direction(TRIGGER_PORT, pin, GPIO_PIN_OUTPUT);
-        gpio_write(TRIGGER_PORT, pin, GPIO_PIN_LOW);
+        pins = &slot_pins[i];
+        
+        // Trigger pins as outputs (LOW)
+        if(pins->trig_port != SLOT_PORT_SHIFTREG) {
+            gpio_set_direction(pins->trig_port, pins->trig_pin, GPIO_PIN_OUTPUT);
+            gpio_write(pins->trig_port, pins->trig_pin, GPIO_PIN_LOW);
+        }
+        
+        // Echo pins as inputs without pull-ups
+        gpio_set_direction(pins->echo_port, pins->echo_pin, GPIO_PIN_INPUT);
+        gpio_set_pullup(pins->echo_port, pins->echo_pin, 0);
     }
     
-    // Initialize echo pins as inputs
-    gpio_set_direction(ECHO_1_PORT, ECHO_1_PIN, GPIO_PIN_INPUT);
-    gpio_set_direction(ECHO_2_PORT, ECHO_2_PIN, GPIO_PIN_INPUT);
-    gpio_set_direction(ECHO_3_PORT, ECHO_3_PIN, GPIO_PIN_INPUT);
-    gpio_set_direction(ECHO_4_PORT, ECHO_4_PIN, GPIO_PIN_INPUT);
-    gpio_set_direction(ECHO_5_PORT, ECHO_5_PIN, GPIO_PIN_INPUT);
-    gpio_set_direction(ECHO_6_PORT, ECHO_6_PIN, GPIO_PIN_INPUT);
-    
-    // Disable pull-ups on all echo pins
-    gpio_set_pullup(ECHO_1_PORT, ECHO_1_PIN, 0);
-    gpio_set_pullup(ECHO_2_PORT, ECHO_2_PIN, 0);
-    gpio_set_pullup(ECHO_3_PORT, ECHO_3_PIN, 0);
-    gpio_set_pullup(ECHO_4_PORT, ECHO_4_PIN, 0);
-<<<<<<< HEAD
-    gpio_set_pullup(ECHO_5_PORT, ECHO_5_PIN, 0);    
-=======
-    gpio_set_pullup(ECHO_5_PORT, ECHO_5_PIN, 0);
->>>>>>> b028cb4a59e53d13bc4401150383cd2914b18671
-    gpio_set_pullup(ECHO_6_PORT, ECHO_6_PIN, 0);
-    
-    // Configure Timer1 for microsecond timing (prescaler 8)
-    TCCR1A = 0;
-    TCCR1B = (1 << CS11); // Prescaler = 8 (0.5µs per tick at 16MHz)
-    
-    // Configure Pin Change Interrupts for all sensors (PORTB)
-    PCICR |= (1 << PCIE0);                  // Enable PCINT0_vect (PORTB)
-    PCMSK0 |= (1 << PCINT0) |               // PB0 (Sensor 1)
-              (1 << PCINT1) |               // PB1 (Sensor 2)
-              (1 << PCINT2) |               // PB2 (Sensor 3)
-              (1 << PCINT3) |               // PB3 (Sensor 4)
-              (1 << PCINT4) |               // PB4 (Sensor 5) - D12
-              (1 << PCINT5);                // PB5 (Sensor 6) - D13
-    
-    // Store initial state of PORTB for change detection
-    last_portb_state = PINB;
+    // Store initial pin states for change detection
+    last_echo_state[GPIO_PORT_B] = PINB;
+    last_echo_state[GPIO_PORT_C] = PINC;
+    last_echo_state[GPIO_PORT_D] = PIND;
+    
+    // Configure Pin Change Interrupts on every bank that carries an echo
+    if(ECHO_MASK_PORTB) {
+        PCMSK0 |= ECHO_MASK_PORTB;
+        PCICR |= (1 << PCIE0);
+    }
+    if(ECHO_MASK_PORTC) {
+        PCMSK1 |= ECHO_MASK_PORTC;
+        PCICR |= (1 << PCIE1);
+    }
+    if(ECHO_MASK_PORTD) {
+        PCMSK2 |= ECHO_MASK_PORTD;
+        PCICR |= (1 << PCIE2);
+    }
     
     // Reset all measurements
     for(i = 0; i < NUM_SENSORS; i++) {
@@ -78,25 +195,45 @@ void ultrasonic_init_all(void) {
 
 // Initialize LEDs
 void led_init(void) {
-    // Initialize LED pins as outputs (different ports)
+    uint8_t i;
     
-    // Sensor 1-4 LEDs on PORTC (A0-A3)
-    gpio_set_direction(LED1_PORT, LED1_PIN, GPIO_PIN_OUTPUT);
-    gpio_set_direction(LED2_PORT, LED2_PIN, GPIO_PIN_OUTPUT);
-    gpio_set_direction(LED3_PORT, LED3_PIN, GPIO_PIN_OUTPUT);
-    gpio_set_direction(LED4_PORT, LED4_PIN, GPIO_PIN_OUTPUT);
+#if SHIFTREG_ENABLED
+    shiftreg_init();
+#endif
     
-    // Sensor 5-6 LEDs on PORTD (D0-D1)
-    gpio_set_direction(LED5_PORT, LED5_PIN, GPIO_PIN_OUTPUT);
-    gpio_set_direction(LED6_PORT, LED6_PIN, GPIO_PIN_OUTPUT);
+    // LED pins as outputs, all off
+    for(i = 0; i < NUM_SENSORS; i++) {
+        if(slot_pins[i].led_port != SLOT_PORT_SHIFTREG) {
+            gpio_set_direction(slot_pins[i].led_port, slot_pins[i].led_pin, GPIO_PIN_OUTPUT);
+        }
+        slot_output(slot_pins[i].led_port, slot_pins[i].led_pin, 0);
+    }
+}
+
+// Switch the LED of a specific sensor
+void set_sensor_led(SensorID_t sensor_id, uint8_t on) {
+    if(sensor_id >= NUM_SENSORS) return;
+    slot_output(slot_pins[sensor_id].led_port, slot_pins[sensor_id].led_pin, on);
+}
+
+// Switch every sensor LED at once: LEDs in on_mask lit, the rest off.
+// Each port is written with a single store.
+void set_sensor_leds(SensorMask_t on_mask) {
+    SlotBits_t bits;
+#if SHIFTREG_ENABLED
+    SlotBits_t all;
+    
+    collect_pins(SENSOR_MASK_ALL, 1, &all);
+#endif
     
-    // Turn all LEDs off initially
-    gpio_write(LED1_PORT, LED1_PIN, GPIO_PIN_LOW);
-    gpio_write(LED2_PORT, LED2_PIN, GPIO_PIN_LOW);
-    gpio_write(LED3_PORT, LED3_PIN, GPIO_PIN_LOW);
-    gpio_write(LED4_PORT, LED4_PIN, GPIO_PIN_LOW);
-    gpio_write(LED5_PORT, LED5_PIN, GPIO_PIN_LOW);
-    gpio_write(LED6_PORT, LED6_PIN, GPIO_PIN_LOW);
+    collect_pins(on_mask, 1, &bits);
+    
+    if(LED_MASK_PORTB) gpio_write_bits(GPIO_PORT_B, LED_MASK_PORTB, bits.port[GPIO_PORT_B]);
+    if(LED_MASK_PORTC) gpio_write_bits(GPIO_PORT_C, LED_MASK_PORTC, bits.port[GPIO_PORT_C]);
+    if(LED_MASK_PORTD) gpio_write_bits(GPIO_PORT_D, LED_MASK_PORTD, bits.port[GPIO_PORT_D]);
+#if SHIFTREG_ENABLED
+    shiftreg_write_bits(all.chain, bits.chain);
+#endif
 }
 
 // Update LED for a specific sensor
@@ -104,30 +241,7 @@ void update_sensor_led(SensorID_t sensor_id, uint16_t distance) {
     if(sensor_id >= NUM_SENSORS) return;
     
     // Determine LED state based on distance
-    GpioValue_t led_state = (distance > 0 && distance <= 10) ? 
-                            GPIO_PIN_HIGH : GPIO_PIN_LOW;
-    
-    // Update the appropriate LED
-    switch(sensor_id) {
-        case SENSOR_1:
-            gpio_write(LED1_PORT, LED1_PIN, led_state);
-            break;
-        case SENSOR_2:
-            gpio_write(LED2_PORT, LED2_PIN, led_state);
-            break;
-        case SENSOR_3:
-            gpio_write(LED3_PORT, LED3_PIN, led_state);
-            break;
-        case SENSOR_4:
-            gpio_write(LED4_PORT, LED4_PIN, led_state);
-            break;
-        case SENSOR_5:
-            gpio_write(LED5_PORT, LED5_PIN, led_state);
-            break;
-        case SENSOR_6:
-            gpio_write(LED6_PORT, LED6_PIN, led_state);
-            break;
-    }
+    set_sensor_led(sensor_id, distance > 0 && distance <= 10);
 }
 
 // Update all LEDs based on distances
@@ -139,70 +253,237 @@ void update_all_leds(uint16_t distances[]) {
     }
 }
 
-// Trigger All Sensors Simultaneously
-void ultrasonic_trigger_all(void) {
+// Trigger every sensor in a mask with one shared 10µs pulse
+void ultrasonic_trigger_mask(SensorMask_t sensor_mask) {
     uint8_t i;
     
     // Reset measurement flags
     for(i = 0; i < NUM_SENSORS; i++) {
-        measurement_done[i] = 0;
-        measurement_active[i] = 0;
+        if(sensor_mask & SENSOR_MASK(i)) {
+            measurement_done[i] = 0;
+            measurement_active[i] = 0;
+        }
     }
     
-    // Send 10µs pulse to all trigger pins
-    for(i = 0; i < NUM_SENSORS; i++) {
-        uint8_t pin = get_trigger_pin(i);
-        gpio_write(TRIGGER_PORT, pin, GPIO_PIN_HIGH);
-    }
+    // Send 10µs pulse to the selected trigger pins
+    write_triggers(sensor_mask, GPIO_PIN_HIGH);
     _delay_us(10);
-    for(i = 0; i < NUM_SENSORS; i++) {
-        uint8_t pin = get_trigger_pin(i);
-        gpio_write(TRIGGER_PORT, pin, GPIO_PIN_LOW);
-    }
+    write_triggers(sensor_mask, GPIO_PIN_LOW);
+}
+
+// Trigger All Sensors Simultaneously
+void ultrasonic_trigger_all(void) {
+    ultrasonic_trigger_mask(SENSOR_MASK_ALL);
 }
 
 // Trigger Single Sensor
 void ultrasonic_trigger_single(SensorID_t sensor_id) {
     if(sensor_id >= NUM_SENSORS) return;
+    ultrasonic_trigger_mask(SENSOR_MASK(sensor_id));
+}
+
+// Arm the compare-match deadline `ticks` from now (interrupts disabled)
+static void deadline_arm(uint16_t ticks) {
+    OCR1A = TCNT1 + ticks;
+    TIFR1 = (1 << OCF1A);   // Drop a stale match before enabling
+    TIMSK1 |= (1 << OCIE1A);
+}
+
+static void deadline_cancel(void) {
+    TIMSK1 &= ~(1 << OCIE1A);
+}
+
+// Sensors of the next group that has any in the sweep, skipping groups
+// that have none; 0 when the sweep has no groups left
+static SensorMask_t sweep_peek_group(void) {
+    SensorMask_t group;
     
-    measurement_done[sensor_id] = 0;
-    measurement_active[sensor_id] = 0;
+    while(sweep_group < NUM_FIRING_GROUPS) {
+        group = firing_groups[sweep_group] & sweep_mask;
+        if(group) return group;
+        sweep_group++;
+    }
+    return 0;
+}
+
+// Fire the next group, or end the sweep if there is none
+// (interrupts disabled)
+static void sweep_fire_next(void) {
+    SensorMask_t group = sweep_peek_group();
     
-    uint8_t pin = get_trigger_pin(sensor_id);
-    gpio_write(TRIGGER_PORT, pin, GPIO_PIN_HIGH);
-    _delay_us(10);
-    gpio_write(TRIGGER_PORT, pin, GPIO_PIN_LOW);
+    if(!group) {
+        deadline_cancel();
+        sweep_phase = SWEEP_IDLE;
+        last_sweep_end = clock_now();
+        last_sweep_us = CLOCK_TICKS_TO_US(last_sweep_end - sweep_start);
+        if(sweep_done_func) {
+            sweep_done_func();
+        }
+        return;
+    }
+    
+    sweep_group++;
+    sweep_waiting = group;
+    sweep_phase = SWEEP_ECHO;
+    ultrasonic_trigger_mask(group);
+    deadline_arm(PULSE_TIMEOUT_TICKS);
 }
 
-// Get Distance from Specific Sensor
-uint16_t ultrasonic_get_distance(SensorID_t sensor_id) {
-    uint32_t pulse_duration;
-    uint32_t duration_us;
-    uint16_t distance_cm;
+// The current group is over: every echo landed or the deadline fired.
+// Sensors still waiting are timed out; an echo still high is abandoned so
+// a late falling edge cannot complete it, and a sensor whose echo never
+// rose is marked silent. (interrupts disabled)
+static void sweep_group_done(void) {
+    SensorMask_t missing = sweep_waiting;
+    uint8_t i;
     
-    if(sensor_id >= NUM_SENSORS) return 0;
-    if(!measurement_done[sensor_id]) return 0;
+    deadline_cancel();
+    sweep_waiting = 0;
+    if(missing) {
+        sweep_timed_out |= missing;
+        for(i = 0; i < NUM_SENSORS; i++) {
+            if(missing & SENSOR_MASK(i)) {
+                if(!measurement_active[i]) {
+                    sweep_silent |= SENSOR_MASK(i);
+                }
+                measurement_active[i] = 0;
+            }
+        }
+    }
     
-    // Calculate pulse duration
-    if(pulse_end[sensor_id] >= pulse_start[sensor_id]) {
-        pulse_duration = pulse_end[sensor_id] - pulse_start[sensor_id];
-    } else {
-        // Handle timer overflow
-        pulse_duration = (65535 - pulse_start[sensor_id]) + pulse_end[sensor_id];
+#if FIRING_GUARD_MS > 0
+    if(sweep_peek_group()) {
+        sweep_phase = SWEEP_GUARD;
+        deadline_arm(FIRING_GUARD_TICKS);
+        return;
+    }
+#endif
+    sweep_fire_next();
+}
+
+// Called from interrupt context when a sweep completes
+void ultrasonic_set_sweep_done(SweepDoneFunc_t func) {
+    sweep_done_func = func;
+}
+
+// Start a sweep over the given sensors: the part of each group that is in
+// the mask fires in turn, moving on as soon as the group has answered.
+// Returns at once; the sweep-done callback runs when it completes. Returns
+// 0 (and starts nothing) if a sweep is already running.
+uint8_t ultrasonic_sweep_start(SensorMask_t sensor_mask) {
+    uint8_t sreg = SREG;
+    
+    cli();
+    if(sweep_phase != SWEEP_IDLE) {
+        SREG = sreg;
+        return 0;
     }
+    sweep_start = clock_now();
+    sweep_mask = sensor_mask;
+    sweep_timed_out = 0;
+    sweep_silent = 0;
+    sweep_group = 0;
+    sweep_fire_next();
+    SREG = sreg;
+    return 1;
+}
+
+uint8_t ultrasonic_sweep_busy(void) {
+    return sweep_phase != SWEEP_IDLE;
+}
+
+// Sensors of the last sweep whose echo never ended before the deadline
+SensorMask_t ultrasonic_timed_out_mask(void) {
+    return sweep_timed_out;
+}
+
+// Sensors of the last sweep that timed out without even starting an echo
+// (unplugged or dead, rather than nothing in range)
+SensorMask_t ultrasonic_silent_mask(void) {
+    return sweep_silent;
+}
+
+// Run a sweep and wait for it, for callers without a scheduler
+void ultrasonic_sweep_mask(SensorMask_t sensor_mask) {
+    if(!ultrasonic_sweep_start(sensor_mask)) return;
+    while(sweep_phase != SWEEP_IDLE) {
+        _NOP();
+    }
+}
+
+// Run one full sweep over every sensor and wait for it
+void ultrasonic_sweep(void) {
+    ultrasonic_sweep_mask(SENSOR_MASK_ALL);
+}
+
+// Duration of the most recent sweep in microseconds
+uint32_t ultrasonic_last_sweep_us(void) {
+    uint32_t us;
+    uint8_t sreg = SREG;
     
-    // Convert timer ticks to microseconds (0.5µs per tick)
-    duration_us = pulse_duration / 2;
+    cli();
+    us = last_sweep_us;
+    SREG = sreg;
+    return us;
+}
+
+// Clock time (clock_now) the most recent sweep ended
+uint32_t ultrasonic_last_sweep_end(void) {
+    uint32_t end;
+    uint8_t sreg = SREG;
     
-    // Convert to centimeters (58µs per cm round trip)
-    distance_cm = duration_us / 58;
+    cli();
+    end = last_sweep_end;
+    SREG = sreg;
+    return end;
+}
+
+// Get Echo Pulse Width from Specific Sensor
+// Returns Timer1 ticks, or 0 if not measured or outside the reliable range
+uint16_t ultrasonic_get_pulse_ticks(SensorID_t sensor_id) {
+    uint32_t pulse_duration;
+    uint8_t sreg;
     
-    // Validate distance range
-    if(distance_cm < MIN_DISTANCE_CM || distance_cm > MAX_DISTANCE_CM) {
+    if(sensor_id >= NUM_SENSORS) return 0;
+    if(!measurement_done[sensor_id]) return 0;
+    
+    // Calculate pulse duration (32-bit timestamps, so wrap is harmless)
+    sreg = SREG;
+    cli();
+    pulse_duration = pulse_end[sensor_id] - pulse_start[sensor_id];
+    SREG = sreg;
+    
+    // Validate against the precomputed range (no division needed)
+    if(pulse_duration < MIN_PULSE_TICKS || pulse_duration > MAX_PULSE_TICKS) {
         return 0;
     }
     
-    return distance_cm;
+    return (uint16_t)pulse_duration;
+}
+
+// Clock time of the falling echo edge that ended the last measurement
+// (only meaningful while ultrasonic_is_measurement_done())
+uint32_t ultrasonic_get_echo_time(SensorID_t sensor_id) {
+    uint32_t end;
+    uint8_t sreg;
+    
+    if(sensor_id >= NUM_SENSORS) return 0;
+    sreg = SREG;
+    cli();
+    end = pulse_end[sensor_id];
+    SREG = sreg;
+    return end;
+}
+
+// Convert a pulse width to centimetres: ticks / 116 computed as
+// ((ticks / 4) * 2260) >> 16, which is exact for every 16-bit input
+uint16_t ultrasonic_ticks_to_cm(uint16_t ticks) {
+    return (uint16_t)(((uint32_t)(ticks >> 2) * 2260UL) >> 16);
+}
+
+// Get Distance from Specific Sensor (diagnostics; the FSM uses ticks)
+uint16_t ultrasonic_get_distance(SensorID_t sensor_id) {
+    return ultrasonic_ticks_to_cm(ultrasonic_get_pulse_ticks(sensor_id));
 }
 
 // Check if Measurement is Complete
@@ -220,94 +501,52 @@ void ultrasonic_reset_measurement(SensorID_t sensor_id) {
     pulse_end[sensor_id] = 0;
 }
 
-// Pin Change Interrupt Service Routine for PORTB (All 6 sensors)
-ISR(PCINT0_vect) {
-    uint8_t current_state = PINB;
-    uint8_t changed_bits = current_state ^ last_portb_state;
-    
-    // Sensor 1 (PB0/D8)
-    if(changed_bits & (1 << PB0)) {
-        if(current_state & (1 << PB0)) {
-            pulse_start[SENSOR_1] = TCNT1;
-            measurement_active[SENSOR_1] = 1;
-        } else {
-            if(measurement_active[SENSOR_1]) {
-                pulse_end[SENSOR_1] = TCNT1;
-                measurement_done[SENSOR_1] = 1;
-                measurement_active[SENSOR_1] = 0;
-            }
-        }
-    }
+// Pin Change Handling, shared by the three PCINT banks
+// Only the pins that changed are touched, and every edge seen in one
+// interrupt shares the timestamp captured on entry. Inlined into each ISR
+// so the bank and its echo mask are constants.
+static inline __attribute__((always_inline))
+void echo_edges(uint8_t bank, uint8_t echo_mask, uint16_t tcnt, uint8_t current_state) {
+    uint8_t changed_bits = (current_state ^ last_echo_state[bank]) & echo_mask;
+    uint32_t now;
     
-    // Sensor 2 (PB1/D9)
-    if(changed_bits & (1 << PB1)) {
-        if(current_state & (1 << PB1)) {
-            pulse_start[SENSOR_2] = TCNT1;
-            measurement_active[SENSOR_2] = 1;
-        } else {
-            if(measurement_active[SENSOR_2]) {
-                pulse_end[SENSOR_2] = TCNT1;
-                measurement_done[SENSOR_2] = 1;
-                measurement_active[SENSOR_2] = 0;
-            }
-        }
-    }
+    last_echo_state[bank] = current_state;
+    if(!changed_bits) return;
     
-    // Sensor 3 (PB2/D10)
-    if(changed_bits & (1 << PB2)) {
-        if(current_state & (1 << PB2)) {
-            pulse_start[SENSOR_3] = TCNT1;
-            measurement_active[SENSOR_3] = 1;
-        } else {
-            if(measurement_active[SENSOR_3]) {
-                pulse_end[SENSOR_3] = TCNT1;
-                measurement_done[SENSOR_3] = 1;
-                measurement_active[SENSOR_3] = 0;
-            }
-        }
-    }
+    now = clock_extend(tcnt);
     
-    // Sensor 4 (PB3/D11)
-    if(changed_bits & (1 << PB3)) {
-        if(current_state & (1 << PB3)) {
-            pulse_start[SENSOR_4] = TCNT1;
-            measurement_active[SENSOR_4] = 1;
-        } else {
-            if(measurement_active[SENSOR_4]) {
-                pulse_end[SENSOR_4] = TCNT1;
-                measurement_done[SENSOR_4] = 1;
-                measurement_active[SENSOR_4] = 0;
-            }
-        }
-    }
+    SLOT_TABLE(SLOT_ECHO_EDGE)
     
-    // Sensor 5 (PB4/D12)
-    if(changed_bits & (1 << PB4)) {
-        if(current_state & (1 << PB4)) {
-            pulse_start[SENSOR_5] = TCNT1;
-            measurement_active[SENSOR_5] = 1;
-        } else {
-            if(measurement_active[SENSOR_5]) {
-                pulse_end[SENSOR_5] = TCNT1;
-                measurement_done[SENSOR_5] = 1;
-                measurement_active[SENSOR_5] = 0;
-            }
-        }
+    // Last echo of the group: move on without waiting for the deadline
+    if(sweep_phase == SWEEP_ECHO && !sweep_waiting) {
+        sweep_group_done();
     }
-    
-    // Sensor 6 (PB5/D13)
-    if(changed_bits & (1 << PB5)) {
-        if(current_state & (1 << PB5)) {
-            pulse_start[SENSOR_6] = TCNT1;
-            measurement_active[SENSOR_6] = 1;
-        } else {
-            if(measurement_active[SENSOR_6]) {
-                pulse_end[SENSOR_6] = TCNT1;
-                measurement_done[SENSOR_6] = 1;
-                measurement_active[SENSOR_6] = 0;
-            }
-        }
+}
+
+// Pin Change Interrupt Service Routines (PORTB, PORTC, PORTD)
+// A bank without echo pins is never enabled, so its ISR never runs.
+ISR(PCINT0_vect) {
+    uint16_t tcnt = TCNT1;
+    echo_edges(GPIO_PORT_B, ECHO_MASK_PORTB, tcnt, PINB);
+}
+
+ISR(PCINT1_vect) {
+    uint16_t tcnt = TCNT1;
+    echo_edges(GPIO_PORT_C, ECHO_MASK_PORTC, tcnt, PINC);
+}
+
+ISR(PCINT2_vect) {
+    uint16_t tcnt = TCNT1;
+    echo_edges(GPIO_PORT_D, ECHO_MASK_PORTD, tcnt, PIND);
+}
+
+// Timer1 Compare Match A: echo deadline or end of the guard time
+ISR(TIMER1_COMPA_vect) {
+    if(sweep_phase == SWEEP_ECHO) {
+        sweep_group_done();
+    } else if(sweep_phase == SWEEP_GUARD) {
+        sweep_fire_next();
+    } else {
+        deadline_cancel();
     }
-    
-    last_portb_state = current_state;
-}
\ No newline at end of file
+}
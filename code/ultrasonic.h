@@ -3,72 +3,90 @@
 
 #include <avr/io.h>
 #include <stdint.h>
+#include "slots.h"   // Slot count, sensor IDs, masks and pin table
 
-// Number of Sensors 
-#define NUM_SENSORS 6
+// Timing Constants 
+#define PULSE_TIMEOUT_US   30000  // 30ms timeout
+#define MIN_DISTANCE_CM    2      // Minimum reliable distance
+#define MAX_DISTANCE_CM    400    // Maximum reliable distance
 
-// Sensor IDs 
-typedef enum {
-    SENSOR_1,
-    SENSOR_2, 
-    SENSOR_3,
-    SENSOR_4,
-    SENSOR_5,
-    SENSOR_6
-} SensorID_t;
+// Distance <-> Timer1 ticks (58us/cm round trip at 2 ticks/us). The hot
+// path compares raw pulse widths against these compile-time limits; a
+// distance of N cm covers widths CM_TO_TICKS(N) .. CM_TO_TICKS(N + 1) - 1.
+#define TICKS_PER_CM       116UL
+#define CM_TO_TICKS(cm)    ((uint16_t)((uint32_t)(cm) * TICKS_PER_CM))
+#define CM_MAX_TICKS(cm)   ((uint16_t)((uint32_t)((cm) + 1) * TICKS_PER_CM - 1))
+#define MIN_PULSE_TICKS    CM_TO_TICKS(MIN_DISTANCE_CM)
+#define MAX_PULSE_TICKS    CM_MAX_TICKS(MAX_DISTANCE_CM)
 
-// Pin Configuration for 6 Sensors 
-// TRIGGER pins (all outputs on PORTD)
-#define TRIGGER_PORT   GPIO_PORT_D
-#define TRIGGER_1_PIN  2  // PD2 
-#define TRIGGER_2_PIN  3  // PD3 
-#define TRIGGER_3_PIN  4  // PD4 
-#define TRIGGER_4_PIN  5  // PD5 
-#define TRIGGER_5_PIN  6  // PD6 
-#define TRIGGER_6_PIN  7  // PD7 
+// Measurement Strategies (select with -DMEASURE_STRATEGY=...)
+// Every strategy is a table of firing groups fired back-to-back; sensors in
+// one group are triggered together.
+#define STRATEGY_SIMULTANEOUS  0  // One group with every sensor (fast, crosstalk-prone)
+#define STRATEGY_SEQUENTIAL    1  // One sensor per group (accurate, slow)
+#define STRATEGY_GROUPED       2  // Non-interfering groups from FIRING_GROUPS
 
-// ECHO pins (inputs with interrupts)
-#define ECHO_1_PORT    GPIO_PORT_B
-#define ECHO_1_PIN     0  // PB0 - PCINT0
-#define ECHO_2_PORT    GPIO_PORT_B  
-#define ECHO_2_PIN     1  // PB1 - PCINT1
-#define ECHO_3_PORT    GPIO_PORT_B
-#define ECHO_3_PIN     2  // PB2 - PCINT2
-#define ECHO_4_PORT    GPIO_PORT_B
-#define ECHO_4_PIN     3  // PB3 - PCINT3
-#define ECHO_5_PORT    GPIO_PORT_B
-#define ECHO_5_PIN     4  // PB4 - PCINT4
-#define ECHO_6_PORT    GPIO_PORT_B
-#define ECHO_6_PIN     5  // PB5 - PCINT5
+#ifndef MEASURE_STRATEGY
+#define MEASURE_STRATEGY STRATEGY_GROUPED
+#endif
 
-// LED Configuration
-// Sensors 1-4 LEDs on PORTC, Sensors 5-6 LEDs on PORTD
-#define LED1_PORT      GPIO_PORT_C
-#define LED1_PIN       0  // PC0 - Sensor 1 LED
-#define LED2_PORT      GPIO_PORT_C
-#define LED2_PIN       1  // PC1 - Sensor 2 LED
-#define LED3_PORT      GPIO_PORT_C
-#define LED3_PIN       2  // PC2 - Sensor 3 LED
-#define LED4_PORT      GPIO_PORT_C
-#define LED4_PIN       3  // PC3 - Sensor 4 LED
-#define LED5_PORT      GPIO_PORT_D
-#define LED5_PIN       0  // PD0 - Sensor 5 LED
-#define LED6_PORT      GPIO_PORT_D
-#define LED6_PIN       1  // PD1 - Sensor 6 LED
+// Groups for STRATEGY_GROUPED: slots that are physically far apart so
+// their beams and echoes do not overlap (default from the board layout)
+#ifndef FIRING_GROUPS
+#define FIRING_GROUPS SLOT_FIRING_GROUPS
+#define FIRING_GROUP_COUNT SLOT_FIRING_GROUP_COUNT
+#endif
 
-// Timing Constants 
-#define PULSE_TIMEOUT_US   30000  // 30ms timeout
-#define MIN_DISTANCE_CM    2      // Minimum reliable distance
-#define MAX_DISTANCE_CM    400    // Maximum reliable distance
+// Quiet time after each group so late reflections die down before the
+// next group fires
+#ifndef FIRING_GUARD_MS
+#if MEASURE_STRATEGY == STRATEGY_SEQUENTIAL
+#define FIRING_GUARD_MS    15
+#elif MEASURE_STRATEGY == STRATEGY_GROUPED
+#define FIRING_GUARD_MS    4
+#else
+#define FIRING_GUARD_MS    0
+#endif
+#endif
+
+// Longest a sweep can take: every group waits out the full echo timeout
+// and its guard. A custom FIRING_GROUPS needs a FIRING_GROUP_COUNT too.
+#if MEASURE_STRATEGY == STRATEGY_SIMULTANEOUS
+#define SWEEP_GROUPS       1
+#elif MEASURE_STRATEGY == STRATEGY_SEQUENTIAL
+#define SWEEP_GROUPS       NUM_SENSORS
+#else
+#define SWEEP_GROUPS       FIRING_GROUP_COUNT
+#endif
+#define SWEEP_WORST_MS     (SWEEP_GROUPS * (PULSE_TIMEOUT_US / 1000 + FIRING_GUARD_MS))
+
+// Called from interrupt context when a sweep completes
+typedef void (*SweepDoneFunc_t)(void);
 
 // Public API Prototypes 
+// (Echo timing and sweep deadlines use Timer1; call clock_init() first)
 void ultrasonic_init_all(void);
 void led_init(void);
 void ultrasonic_trigger_all(void);
 void ultrasonic_trigger_single(SensorID_t sensor_id);
+void ultrasonic_trigger_mask(SensorMask_t sensor_mask);
+void ultrasonic_set_sweep_done(SweepDoneFunc_t func);
+uint8_t ultrasonic_sweep_start(SensorMask_t sensor_mask);
+uint8_t ultrasonic_sweep_busy(void);
+SensorMask_t ultrasonic_timed_out_mask(void);
+SensorMask_t ultrasonic_silent_mask(void);
+void ultrasonic_sweep(void);
+void ultrasonic_sweep_mask(SensorMask_t sensor_mask);
+uint32_t ultrasonic_last_sweep_us(void);
+uint32_t ultrasonic_last_sweep_end(void);
+uint16_t ultrasonic_get_pulse_ticks(SensorID_t sensor_id);
+uint32_t ultrasonic_get_echo_time(SensorID_t sensor_id);
+uint16_t ultrasonic_ticks_to_cm(uint16_t ticks);
 uint16_t ultrasonic_get_distance(SensorID_t sensor_id);
 uint8_t ultrasonic_is_measurement_done(SensorID_t sensor_id);
 void ultrasonic_reset_measurement(SensorID_t sensor_id);
+void set_sensor_led(SensorID_t sensor_id, uint8_t on);
+void set_sensor_leds(SensorMask_t on_mask);
 void update_sensor_led(SensorID_t sensor_id, uint16_t distance);
 void update_all_leds(uint16_t distances[]);
 
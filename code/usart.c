@@ -0,0 +1,84 @@
+#include "usart.h"
+#include "gpio.h"
+#include "slots.h"   // Board options (RS-485 DE pin)
+#include <avr/interrupt.h>
+
+#define USART_QUEUE_MASK (USART_QUEUE_SIZE - 1)
+
+// Ring buffer of pending bytes, same free-running head/tail scheme as twi.c
+static volatile uint8_t queue_data[USART_QUEUE_SIZE];
+static volatile uint8_t queue_head = 0;        // Written by producer only
+static volatile uint8_t queue_tail = 0;        // Written by ISR only
+static uint16_t dropped = 0;                   // Writes rejected for lack of room
+
+// Start the transmitter (8N1, TX only, double speed for a closer match
+// of the common baud rates at 16 MHz)
+void usart_init(uint32_t baud) {
+    uint16_t ubrr = (uint16_t)((F_CPU / 8 + baud / 2) / baud - 1);
+
+    UBRR0H = (uint8_t)(ubrr >> 8);
+    UBRR0L = (uint8_t)ubrr;
+    UCSR0A = (1 << U2X0);
+    UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
+    UCSR0B = (1 << TXEN0);
+
+#ifdef USART_DE_PORT
+    gpio_dir(USART_DE_PORT, USART_DE_PIN, GPIO_PIN_OUTPUT);
+    gpio_set(USART_DE_PORT, USART_DE_PIN, GPIO_PIN_LOW);
+    UCSR0B |= (1 << TXCIE0);
+#endif
+}
+
+// Queue a whole message for transmission. Returns 0 (and queues nothing)
+// if it does not fit, so a full queue never produces a torn frame.
+uint8_t usart_write(const uint8_t *data, uint8_t len) {
+    uint8_t i;
+
+    if((uint8_t)(USART_QUEUE_SIZE - (uint8_t)(queue_head - queue_tail)) < len) {
+        dropped++;
+        return 0;
+    }
+
+    for(i = 0; i < len; i++) {
+        queue_data[queue_head & USART_QUEUE_MASK] = data[i];
+        queue_head++;
+    }
+
+#ifdef USART_DE_PORT
+    gpio_set(USART_DE_PORT, USART_DE_PIN, GPIO_PIN_HIGH);
+#endif
+    UCSR0B |= (1 << UDRIE0);  // Data-register-empty interrupt drains the queue
+    return 1;
+}
+
+// Nothing queued and the data register empty
+uint8_t usart_is_idle(void) {
+    return queue_head == queue_tail && !(UCSR0B & (1 << UDRIE0)) &&
+           (UCSR0A & (1 << UDRE0));
+}
+
+uint8_t usart_queue_free(void) {
+    return USART_QUEUE_SIZE - (uint8_t)(queue_head - queue_tail);
+}
+
+uint16_t usart_dropped_count(void) {
+    return dropped;
+}
+
+ISR(USART_UDRE_vect) {
+    if(queue_head != queue_tail) {
+        UDR0 = queue_data[queue_tail & USART_QUEUE_MASK];
+        queue_tail++;
+    } else {
+        UCSR0B &= ~(1 << UDRIE0);
+    }
+}
+
+#ifdef USART_DE_PORT
+ISR(USART_TX_vect) {
+    // Release the bus only if nothing new was queued meanwhile
+    if(queue_head == queue_tail) {
+        gpio_set(USART_DE_PORT, USART_DE_PIN, GPIO_PIN_LOW);
+    }
+}
+#endif
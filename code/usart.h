@@ -0,0 +1,23 @@
+#ifndef USART_H
+#define USART_H
+
+#include <avr/io.h>
+#include <stdint.h>
+
+// Transmit queue size in bytes (must be a power of two, max 128). Holds
+// the largest telemetry frame, TELEM_MAX_FRAME, in one write.
+#define USART_QUEUE_SIZE 128
+
+// RS-485 driver enable: define USART_DE_PORT/USART_DE_PIN (GpioPort_t and
+// pin) to drive the transceiver's DE line. It is raised when a write is
+// queued and dropped from the TX-complete interrupt once the last stop bit
+// has left, so the line is released between frames.
+
+// --- Public Function Prototypes ---
+void usart_init(uint32_t baud);
+uint8_t usart_write(const uint8_t *data, uint8_t len);
+uint8_t usart_is_idle(void);
+uint8_t usart_queue_free(void);
+uint16_t usart_dropped_count(void);
+
+#endif // USART_H